@@ -0,0 +1,125 @@
+// This code is part of the Problem Based Benchmark Suite (PBBS)
+// Copyright (c) 2011 Guy Blelloch and the PBBS team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// All nearest smaller values.
+//   prevSmaller: L[i] = max{j < i : A[j] < A[i]} (or <= if orEqual), -1 if none
+//   nextSmaller: R[i] = min{j > i : A[j] < A[i]} (or <= if orEqual), n if none
+// Each block of ANSV_BSIZE elements is first solved with the usual
+// sequential pointer jumping.  The elements left unresolved are the prefix
+// minima of their block; for each of them a tree over the block minima
+// finds the nearest block to the left holding a small enough value, and
+// the answer is found on that block's chain of suffix minima, whose links
+// are all local and already final.
+
+#ifndef _ANSV_hpp_
+#define _ANSV_hpp_
+
+#include "parallel.h"
+#include "utils.h"
+#include "sequence.h"
+#define ANSV_BSIZE 2048
+using namespace std;
+
+namespace ansv {
+
+// A[i] read back to front, so the right hand version reuses the left one
+template <class ET>
+struct reversed {
+  ET* A; long n;
+  reversed(ET* _A, long _n) : A(_A), n(_n) {}
+  ET operator[] (long i) { return A[n-1-i]; }
+};
+
+template <class ET>
+struct direct {
+  ET* A;
+  direct(ET* _A) : A(_A) {}
+  ET operator[] (long i) { return A[i]; }
+};
+
+// does a value a to the left stop the search from value b
+template <class ET>
+inline bool stops(ET a, ET b, bool orEqual) {
+  return orEqual ? !(b < a) : a < b;
+}
+
+template <class ET, class V>
+void prevSmallerView(V A, long n, intT* L, bool orEqual) {
+  if (n == 0) return;
+  long nb = nblocks(n, ANSV_BSIZE);
+  long P = 1;
+  while (P < nb) P *= 2;
+  intT* T = newA(intT, 2*P);  // index of a block minimum, -1 for padding
+
+  // local pointer jumping; -1 marks unresolved
+  parallel_for (long b = 0; b < nb; b++) {
+    long s = b*ANSV_BSIZE, e = min(s+ANSV_BSIZE, n);
+    long m = s;
+    for (long i = s; i < e; i++) {
+      long j = i-1;
+      while (j >= s && !stops(A[j], A[i], orEqual)) j = L[j];
+      L[i] = (j >= s) ? j : -1;
+      if (A[i] < A[m]) m = i;
+    }
+    T[P+b] = m;
+  }
+  parallel_for (long b = nb; b < P; b++) T[P+b] = -1;
+  for (long x = P-1; x > 0; x--) {
+    intT l = T[2*x], r = T[2*x+1];
+    T[x] = (r < 0 || !(A[r] < A[l])) ? l : r;
+  }
+
+  parallel_for (long b = 1; b < nb; b++) {
+    long s = b*ANSV_BSIZE, e = min(s+ANSV_BSIZE, n);
+    for (long i = s; i < e; i++) {
+      if (L[i] >= 0) continue;
+      ET v = A[i];
+      // rightmost block left of b whose minimum stops v
+      long x = P+b;
+      while (x > 1 && !((x & 1) && stops(A[T[x-1]], v, orEqual))) x /= 2;
+      if (x == 1) continue;
+      x--;
+      while (x < P) x = stops(A[T[2*x+1]], v, orEqual) ? 2*x+1 : 2*x;
+      long j = min((x-P+1)*ANSV_BSIZE, n) - 1;
+      while (!stops(A[j], v, orEqual)) j = L[j];
+      L[i] = j;
+    }
+  }
+  free(T);
+}
+
+template <class ET>
+void prevSmaller(ET* A, long n, intT* L, bool orEqual) {
+  prevSmallerView<ET>(direct<ET>(A), n, L, orEqual);
+}
+
+template <class ET>
+void nextSmaller(ET* A, long n, intT* R, bool orEqual) {
+  prevSmallerView<ET>(reversed<ET>(A, n), n, R, orEqual);
+  // reverse and map back to forward indices
+  parallel_for (long i = 0; i < n/2; i++) swap(R[i], R[n-1-i]);
+  parallel_for (long i = 0; i < n; i++) R[i] = n-1-R[i];
+}
+
+}
+
+#endif
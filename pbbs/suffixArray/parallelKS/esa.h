@@ -0,0 +1,163 @@
+// This code is part of the Problem Based Benchmark Suite (PBBS)
+// Copyright (c) 2011 Guy Blelloch and the PBBS team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Enhanced suffix array: SA, LCP and the child table of Abouelhoda,
+// Kurtz and Ohlebusch (Replacing suffix trees with enhanced suffix
+// arrays, 2004), which together navigate the virtual suffix tree in 3n
+// words.
+//
+// Following the paper, lcp(i) = LCP[i-1] is the LCP of SA[i-1] and SA[i]
+// for 0 < i < n, and lcp(0) = lcp(n) = -1.  The up, down and nextlIndex
+// values are packed into one array of n words:
+//   cld[i-1] = up[i]          if lcp(i-1) > lcp(i)
+//   cld[i]   = nextlIndex[i]  if defined
+//   cld[i]   = down[i]        otherwise, where needed
+// and unused entries are 0.
+//
+// Construction is parallel.  With P the previous smaller or equal values
+// of lcp, the indices popped by the sequential stack algorithm at step i
+// are the chain i-1, P[i-1], ... of entries above lcp(i).  These chains
+// are disjoint, so they are walked independently: the last entry is up[i]
+// and every link on the way gives a down value.  nextlIndex[p] is the q
+// with P[q] = p and lcp(q) = lcp(p).
+
+#ifndef _ESA_hpp_
+#define _ESA_hpp_
+
+#include "parallel.h"
+#include "utils.h"
+#include "ansv.h"
+using namespace std;
+
+// Child table for LCP as returned by suffixArray(s, n, true).
+inline uintT* childTable(uintT* LCP, long n) {
+  uintT* cld = newA(uintT, max(1L, n));
+  if (n == 0) return cld;
+  intT* lcp = newA(intT, n+1);
+  lcp[0] = lcp[n] = -1;
+  parallel_for (long i = 1; i < n; i++) lcp[i] = LCP[i-1];
+  intT* P = newA(intT, n+1);
+  ansv::prevSmaller(lcp, n+1, P, true);
+
+  parallel_for (long i = 0; i < n; i++) cld[i] = 0;
+  parallel_for (long q = 1; q < n; q++)
+    if (lcp[P[q]] == lcp[q]) cld[P[q]] = q;
+  parallel_for (long i = 1; i <= n; i++) {
+    if (lcp[i-1] > lcp[i]) {
+      long q = i-1;
+      while (lcp[P[q]] > lcp[i]) {
+        long p = P[q];
+        if (lcp[q] > lcp[p]) cld[p] = q;
+        q = p;
+      }
+      cld[i-1] = q;
+    }
+  }
+  free(P);
+  free(lcp);
+  return cld;
+}
+
+class enhancedSA {
+protected:
+  unsigned char* s;
+  uintT* SA;
+  uintT* LCP;
+  uintT* cld;
+  long n;
+
+ public:
+  // Keeps pointers to s, SA and LCP and builds the child table.
+  enhancedSA(unsigned char* _s, uintT* _SA, uintT* _LCP, long _n)
+    : s(_s), SA(_SA), LCP(_LCP), n(_n) {
+    cld = childTable(LCP, n);
+  }
+
+  long size() { return n; }
+
+  long lcp(long i) { return (i <= 0 || i >= n) ? -1 : (long) LCP[i-1]; }
+
+  // first l-index of the interval [i..j], i < j
+  long firstLIndex(long i, long j) {
+    long up = cld[j];
+    return (i < up && up <= j) ? up : (long) cld[i];
+  }
+
+  // next l-index after k in the same interval, or -1
+  long nextLIndex(long k) {
+    long x = cld[k];
+    return (x > k && lcp(x) == lcp(k)) ? x : -1;
+  }
+
+  // LCP of all suffixes in [i..j]; for a leaf the suffix length
+  long depth(long i, long j) {
+    if (i == j) return n - SA[i];
+    return lcp(firstLIndex(i, j));
+  }
+
+  // applies f(lb, rb) to the child intervals of [i..j] from left to right
+  template <class F>
+  void forChildren(long i, long j, F f) {
+    if (i == j) return;
+    long lb = i;
+    for (long k = firstLIndex(i, j); k >= 0; k = nextLIndex(k)) {
+      f(lb, k-1);
+      lb = k;
+    }
+    f(lb, j);
+  }
+
+  // child interval of [i..j] whose suffixes have c at depth(i, j)
+  bool getChild(long i, long j, unsigned char c, long& ci, long& cj) {
+    long d = depth(i, j);
+    long lb = i;
+    for (long k = firstLIndex(i, j); ; k = nextLIndex(k)) {
+      long rb = (k >= 0) ? k-1 : j;
+      if (SA[lb] + d < n && s[SA[lb] + d] == c) {
+        ci = lb; cj = rb;
+        return true;
+      }
+      if (k < 0) return false;
+      lb = k;
+    }
+  }
+
+  // SA interval [i..j] of the suffixes starting with P[0..m), in
+  // O(m |alphabet|) time
+  bool find(unsigned char* P, long m, long& i, long& j) {
+    i = 0; j = n-1;
+    long k = 0;
+    if (n == 0) return m == 0;
+    while (k < m) {
+      long d = min(depth(i, j), m);
+      for (; k < d; k++)
+        if (s[SA[i] + k] != P[k]) return false;
+      if (k == m || i == j) break;
+      if (!getChild(i, j, P[k], i, j)) return false;
+    }
+    return k == m;
+  }
+
+  ~enhancedSA() { free(cld); }
+};
+
+#endif
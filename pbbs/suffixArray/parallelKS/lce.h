@@ -0,0 +1,98 @@
+// This code is part of the Problem Based Benchmark Suite (PBBS)
+// Copyright (c) 2011 Guy Blelloch and the PBBS team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Longest common extension queries: lce(i, j) is the length of the
+// longest common prefix of suffixes i and j of s.  In general it is the
+// minimum of LCP between the ranks of the two suffixes, found with myRMQ
+// over LCP and the inverse suffix array.  Most extensions are short, so,
+// as with CLEN in the LCP computation of pks.C, the first LCE_CLEN
+// characters are compared directly first with the kernels of mismatch.h
+// and the RMQ is only used past them.
+
+#ifndef _LCE_hpp_
+#define _LCE_hpp_
+
+#include "parallel.h"
+#include "utils.h"
+#include "rangeMin.h"
+#include "mismatch.h"
+#define LCE_CLEN 32
+using namespace std;
+
+class lceIndex {
+protected:
+  unsigned char* s;
+  long n;
+  uintT* LCP;
+  uintT* ISA;
+  bool ownISA;
+  myRMQ* RMQ;
+
+  // common prefix of s+i and s+j up to LCE_CLEN characters, both being
+  // at least that long
+  long directBlock(long i, long j) {
+    return mismatch_bytes(s+i, s+j, LCE_CLEN);
+  }
+
+ public:
+  // SA and LCP as returned by suffixArray(s, n, true).  ISA may be NULL,
+  // in which case it is computed.  The arrays are not copied.
+  lceIndex(unsigned char* _s, uintT* SA, uintT* _LCP, long _n,
+           uintT* _ISA = NULL) : s(_s), n(_n), LCP(_LCP), ISA(_ISA) {
+    ownISA = (ISA == NULL);
+    if (ownISA) {
+      ISA = newA(uintT, n);
+      parallel_for (long i = 0; i < n; i++) ISA[SA[i]] = i;
+    }
+    RMQ = (n > 1) ? new myRMQ(LCP, n-1) : NULL;
+  }
+
+  long size() { return n; }
+
+  long lce(long i, long j) {
+    if (i == j) return n - i;
+    long m = n - max(i, j);
+    long l = 0;
+    if (m >= LCE_CLEN) {
+      l = directBlock(i, j);
+      if (l < LCE_CLEN) return l;
+    } else {
+      while (l < m && s[i+l] == s[j+l]) l++;
+      return l;
+    }
+    long a = ISA[i], b = ISA[j];
+    if (a > b) swap(a, b);
+    return LCP[RMQ->query(a, b-1)];
+  }
+
+  // out[k] = lce(I[k], J[k]) for k < q
+  void lce(uintT* I, uintT* J, uintT* out, long q) {
+    parallel_for (long k = 0; k < q; k++) out[k] = lce(I[k], J[k]);
+  }
+
+  ~lceIndex() {
+    if (ownISA) free(ISA);
+    delete RMQ;
+  }
+};
+
+#endif
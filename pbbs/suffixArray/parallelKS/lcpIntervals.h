@@ -0,0 +1,159 @@
+// This code is part of the Problem Based Benchmark Suite (PBBS)
+// Copyright (c) 2011 Guy Blelloch and the PBBS team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Parallel bottom-up traversal of the lcp-intervals (the internal nodes
+// of the virtual suffix tree) of a suffix array, in the style of
+// Abouelhoda, Kurtz and Ohlebusch.  LCP is laid out as returned by
+// suffixArray(s, n, true): LCP[i] is the LCP of SA[i] and SA[i+1].
+//
+// The visitor is a class V providing
+//   typedef ... T;                          per interval accumulator
+//   T leaf(long i);                         accumulator of SA position i
+//   void merge(T& a, T& b);                 fold child b into a (b may be
+//                                           left in any state)
+//   void visit(long lcp, long lb, long rb, T& a);
+// An interval [lb, rb] is visited once all of its children, which are
+// leaves and smaller intervals, have been merged into it in left to right
+// order; its own accumulator is then merged into its parent.  The root is
+// visited with its own LCP, which is 0 unless all suffixes share a
+// prefix.  leaf, merge and visit are called concurrently on different
+// intervals.
+//
+// The LCP array is cut into chunks right after a low LCP value near each
+// nominal chunk boundary.  Each chunk runs the usual stack algorithm on
+// its own.  Whenever its stack runs empty it cannot tell whether the
+// interval continues one left open by earlier chunks, so it records the
+// pending subtree as an event instead.  Events and the frames still open
+// at the end of each chunk are then replayed in order on one global
+// stack.  Cutting at low LCP values keeps both short.
+
+#ifndef _lcpIntervals_hpp_
+#define _lcpIntervals_hpp_
+
+#include <vector>
+#include <algorithm>
+#include "parallel.h"
+#include "utils.h"
+#define LI_BSIZE (1 << 16)
+#define LI_CUT_WINDOW (LI_BSIZE / 16)
+using namespace std;
+
+template <class T>
+struct lcpFrame {
+  long lcp, lb, rb;  // rb is only used by events: the boundary they close
+  T acc;
+};
+
+// LCP at boundary i, with -1 after the last suffix to close everything
+static inline long lcpAt(uintT* LCP, long n, long i) {
+  return (i < n-1) ? (long) LCP[i] : -1;
+}
+
+// pops every frame above lcp l, merging the pending subtree upwards
+template <class V>
+inline void popFrames(vector<lcpFrame<typename V::T> >& stack,
+                      lcpFrame<typename V::T>& pending, long l, long i,
+                      V& visitor) {
+  while (!stack.empty() && l < stack.back().lcp) {
+    lcpFrame<typename V::T>& top = stack.back();
+    visitor.merge(top.acc, pending.acc);
+    visitor.visit(top.lcp, top.lb, i, top.acc);
+    pending.lb = top.lb;
+    swap(pending.acc, top.acc);
+    stack.pop_back();
+  }
+}
+
+// Runs the stack algorithm over SA positions and boundaries [s, e).
+template <class V>
+void lcpIntervalsChunk(uintT* LCP, long n, long s, long e, V& visitor,
+                       vector<lcpFrame<typename V::T> >& events,
+                       vector<lcpFrame<typename V::T> >& stack) {
+  bool haveBottom = false;
+  long bottom = 0;  // LCP of the outer top of stack after the last event
+  for (long i = s; i < e; i++) {
+    long l = lcpAt(LCP, n, i);
+    lcpFrame<typename V::T> pending;
+    pending.lb = i;
+    pending.acc = visitor.leaf(i);
+    popFrames(stack, pending, l, i, visitor);
+    pending.lcp = l;
+    pending.rb = i;
+    if (!stack.empty() && l == stack.back().lcp)
+      visitor.merge(stack.back().acc, pending.acc);
+    else if (!stack.empty() || (haveBottom && l > bottom))
+      stack.push_back(pending);
+    else {
+      events.push_back(pending);
+      haveBottom = true;
+      bottom = l;
+    }
+  }
+}
+
+template <class V>
+void lcpIntervals(uintT* LCP, long n, V& visitor) {
+  typedef lcpFrame<typename V::T> frame;
+  if (n < 1) return;
+  long nChunks = max(1L, n / LI_BSIZE);
+
+  // chunk c covers [cut[c], cut[c+1]) and ends on the smallest LCP in a
+  // window after its nominal end
+  long* cut = newA(long, nChunks+1);
+  cut[0] = 0;
+  cut[nChunks] = n;
+  parallel_for (long c = 1; c < nChunks; c++) {
+    long start = c * (n / nChunks);
+    long end = min(start + LI_CUT_WINDOW, n-1);
+    long k = start;
+    for (long j = start+1; j < end; j++)
+      if (LCP[j] < LCP[k]) k = j;
+    cut[c] = k+1;
+  }
+
+  vector<frame>* events = new vector<frame>[nChunks];
+  vector<frame>* stacks = new vector<frame>[nChunks];
+  parallel_for_1 (long c = 0; c < nChunks; c++)
+    lcpIntervalsChunk(LCP, n, cut[c], cut[c+1], visitor, events[c],
+                      stacks[c]);
+
+  // replay in order on the global stack
+  vector<frame> stack;
+  for (long c = 0; c < nChunks; c++) {
+    for (size_t k = 0; k < events[c].size(); k++) {
+      frame& pending = events[c][k];
+      popFrames(stack, pending, pending.lcp, pending.rb, visitor);
+      if (!stack.empty() && pending.lcp == stack.back().lcp)
+        visitor.merge(stack.back().acc, pending.acc);
+      else if (pending.lcp >= 0)
+        stack.push_back(pending);
+    }
+    stack.insert(stack.end(), stacks[c].begin(), stacks[c].end());
+    vector<frame>().swap(events[c]);
+    vector<frame>().swap(stacks[c]);
+  }
+  delete [] events;
+  delete [] stacks;
+  free(cut);
+}
+
+#endif
@@ -0,0 +1,138 @@
+// This code is part of the Problem Based Benchmark Suite (PBBS)
+// Copyright (c) 2011 Guy Blelloch and the PBBS team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Parallel LZ77 factorization from SA, LCP and ISA, following Shun and
+// Zhao (Practical parallel Lempel-Ziv factorization, DCC 2013).
+//
+// The longest previous factor of position i is shared with one of the two
+// suffixes nearest to it in the suffix array among those starting before
+// i, i.e. the previous and next smaller SA values around rank ISA[i].
+// These come from ANSV on SA and their LCP from a range minimum query on
+// LCP, so the longest previous factor of every position is found
+// independently.
+//
+// The factors start at 0, next(0), next(next(0)), ... where
+// next(i) = i + max(1, LPF[i]).  This chain is followed by one level of
+// pointer jumping: each block of LZ_BSIZE positions computes, for all its
+// positions, where the chain leaves the block; a sequential pass then
+// hops from block to block, and each block expands its part of the chain
+// in parallel.
+
+#ifndef _LZ77_hpp_
+#define _LZ77_hpp_
+
+#include <stdio.h>
+#include "parallel.h"
+#include "utils.h"
+#include "sequence.h"
+#include "rangeMin.h"
+#include "ansv.h"
+#define LZ_BSIZE 4096
+using namespace std;
+
+// A factor copies length characters from source, or is the single
+// character source when length is 0.
+struct lzFactor {
+  uintT source;
+  uintT length;
+};
+
+// Factors of s[0..n) with SA and LCP as returned by suffixArray(s, n,
+// true).  ISA may be NULL, in which case it is computed.  Returns the
+// factors in text order and their number.
+inline pair<lzFactor*,long> lz77(unsigned char* s, uintT* SA, uintT* LCP,
+                                 uintT* ISA, long n) {
+  if (n == 0) return make_pair(newA(lzFactor, 1), 0L);
+  bool ownISA = (ISA == NULL);
+  if (ownISA) {
+    ISA = newA(uintT, n);
+    parallel_for (long i = 0; i < n; i++) ISA[SA[i]] = i;
+  }
+  intT* PSV = newA(intT, n);
+  intT* NSV = newA(intT, n);
+  ansv::prevSmaller(SA, n, PSV, false);
+  ansv::nextSmaller(SA, n, NSV, false);
+
+  // longest previous factor of each position and where it is copied from
+  uintT* LPF = newA(uintT, n);
+  uintT* src = newA(uintT, n);
+  {
+    myRMQ RMQ(LCP, n);
+    parallel_for (long i = 0; i < n; i++) {
+      long r = ISA[i];
+      long p = PSV[r], q = NSV[r];
+      long lp = (p < 0) ? 0 : (p == r-1) ? LCP[p] : LCP[RMQ.query(p, r-1)];
+      long lq = (q >= n) ? 0 : (q == r+1) ? LCP[r] : LCP[RMQ.query(r, q-1)];
+      LPF[i] = max(lp, lq);
+      src[i] = (LPF[i] == 0) ? s[i] : (lp >= lq) ? SA[p] : SA[q];
+    }
+  }
+  free(PSV);
+
+  // exit[i]: first chain position at or past the end of i's block
+  intT* exit = NSV;
+  long nb = nblocks(n, LZ_BSIZE);
+  parallel_for (long b = 0; b < nb; b++) {
+    long st = b*LZ_BSIZE, e = min(st+LZ_BSIZE, n);
+    for (long i = e-1; i >= st; i--) {
+      long nx = i + max(1L, (long) LPF[i]);
+      exit[i] = (nx >= e) ? nx : exit[nx];
+    }
+  }
+  intT* entry = newA(intT, nb);
+  parallel_for (long b = 0; b < nb; b++) entry[b] = -1;
+  for (long x = 0; x < n; x = exit[x]) entry[x / LZ_BSIZE] = x;
+
+  intT* counts = newA(intT, nb+1);
+  parallel_for (long b = 0; b < nb; b++) {
+    long c = 0, e = min((b+1)*LZ_BSIZE, n);
+    if (entry[b] >= 0)
+      for (long x = entry[b]; x < e; x += max(1L, (long) LPF[x])) c++;
+    counts[b] = c;
+  }
+  long z = sequence::plusScan(counts, counts, nb);
+  lzFactor* F = newA(lzFactor, max(1L, z));
+  parallel_for (long b = 0; b < nb; b++) {
+    long k = counts[b], e = min((b+1)*LZ_BSIZE, n);
+    if (entry[b] >= 0)
+      for (long x = entry[b]; x < e; x += max(1L, (long) LPF[x])) {
+        F[k].source = src[x];
+        F[k].length = LPF[x];
+        k++;
+      }
+  }
+
+  free(counts); free(entry);
+  free(LPF); free(src); free(exit);
+  if (ownISA) free(ISA);
+  return make_pair(F, z);
+}
+
+// Writes the factors as (source, length) pairs of uintT.
+inline int writeFactors(lzFactor* F, long z, char* fileName) {
+  FILE* f = fopen(fileName, "wb");
+  if (f == NULL) return 1;
+  int r = (fwrite(F, sizeof(lzFactor), z, f) != (size_t) z);
+  return fclose(f) || r;
+}
+
+#endif
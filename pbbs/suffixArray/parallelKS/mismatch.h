@@ -0,0 +1,132 @@
+#ifndef __MISMATCH__
+#define __MISMATCH__
+
+/*
+ * Mismatch kernels shared by the suffix comparators and checkers of both
+ * builders: the position of the first difference between two strings,
+ * found a whole vector at a time. Blocks are compared with AVX-512BW,
+ * AVX2 or SSE2, whichever the compiler targets, and the equality mask
+ * gives the first differing byte by its trailing zeros. Short tails and
+ * targets without SSE2 use 64-bit words, whose XOR locates the byte the
+ * same way.
+ *
+ * mismatch_bytes reads nothing past the n bytes it is given.
+ * mismatch_padded finishes the tail with whole words instead, for buffers
+ * with at least MISMATCH_PAD readable bytes past the end, like the zero
+ * padding the lc builder keeps after the text.
+ *
+ * Plain C, so it can be used from the sais tools as well.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__AVX512BW__)
+#include <immintrin.h>
+#define MISMATCH_BLOCK 64
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define MISMATCH_BLOCK 32
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define MISMATCH_BLOCK 16
+#else
+#define MISMATCH_BLOCK 8
+#endif
+
+#define MISMATCH_PAD 7
+
+#if MISMATCH_BLOCK > 8
+/* Bit k set if byte k of the blocks at a and b differ. */
+static inline uint64_t mismatch_block_mask(const void* a, const void* b) {
+#if defined(__AVX512BW__)
+  return _mm512_cmpneq_epi8_mask(_mm512_loadu_si512(a), _mm512_loadu_si512(b));
+#elif defined(__AVX2__)
+  return (uint32_t) ~_mm256_movemask_epi8(
+      _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*) a),
+                        _mm256_loadu_si256((const __m256i*) b)));
+#else
+  return 0xFFFF & ~_mm_movemask_epi8(
+      _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) a),
+                     _mm_loadu_si128((const __m128i*) b)));
+#endif
+}
+#endif
+
+/* Index of the first differing byte of the 8 bytes at a and b, 8 if none. */
+static inline size_t mismatch_word(const unsigned char* a,
+                                   const unsigned char* b) {
+  uint64_t x, y;
+  memcpy(&x, a, 8);
+  memcpy(&y, b, 8);
+  x ^= y;
+  if (x == 0) return 8;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  return __builtin_clzll(x) / 8;
+#else
+  return __builtin_ctzll(x) / 8;
+#endif
+}
+
+/* Length of the common prefix of a[0..n) and b[0..n). */
+static inline size_t mismatch_bytes(const unsigned char* a,
+                                    const unsigned char* b, size_t n) {
+  size_t i = 0, k;
+#if MISMATCH_BLOCK > 8
+  for (; i + MISMATCH_BLOCK <= n; i += MISMATCH_BLOCK) {
+    uint64_t m = mismatch_block_mask(a + i, b + i);
+    if (m) return i + __builtin_ctzll(m);
+  }
+#endif
+  for (; i + 8 <= n; i += 8) {
+    k = mismatch_word(a + i, b + i);
+    if (k < 8) return i + k;
+  }
+  for (; i < n; i++) {
+    if (a[i] != b[i]) return i;
+  }
+  return n;
+}
+
+/* Same as mismatch_bytes, reading up to MISMATCH_PAD bytes past the ends. */
+static inline size_t mismatch_padded(const unsigned char* a,
+                                     const unsigned char* b, size_t n) {
+  size_t i = 0, k;
+#if MISMATCH_BLOCK > 8
+  for (; i + MISMATCH_BLOCK <= n; i += MISMATCH_BLOCK) {
+    uint64_t m = mismatch_block_mask(a + i, b + i);
+    if (m) return i + __builtin_ctzll(m);
+  }
+#endif
+  for (; i < n; i += 8) {
+    k = mismatch_word(a + i, b + i);
+    if (k < 8) return i + k < n ? i + k : n;
+  }
+  return n;
+}
+
+/* Compares a[0..n) with b[0..n) as unsigned bytes, like memcmp. */
+static inline int mismatch_compare(const unsigned char* a,
+                                   const unsigned char* b, size_t n) {
+  size_t k = mismatch_bytes(a, b, n);
+  return k == n ? 0 : (int) a[k] - (int) b[k];
+}
+
+/* Length of the common prefix of a[0..n) and b[0..n), 32-bit symbols. */
+static inline size_t mismatch_u32(const uint32_t* a, const uint32_t* b,
+                                  size_t n) {
+  size_t i = 0;
+#if MISMATCH_BLOCK > 8
+  for (; i + MISMATCH_BLOCK / 4 <= n; i += MISMATCH_BLOCK / 4) {
+    uint64_t m = mismatch_block_mask(a + i, b + i);
+    if (m) return i + __builtin_ctzll(m) / 4;
+  }
+#endif
+  for (; i < n; i++) {
+    if (a[i] != b[i]) return i;
+  }
+  return n;
+}
+
+#endif
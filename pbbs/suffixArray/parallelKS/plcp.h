@@ -0,0 +1,135 @@
+// This code is part of the Problem Based Benchmark Suite (PBBS)
+// Copyright (c) 2011 Guy Blelloch and the PBBS team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Succinct permuted LCP array (Sadakane's 2n-bit encoding).
+// PLCP[p] is the LCP of suffix p with the suffix preceding it in the
+// suffix array.  Since PLCP[p] >= PLCP[p-1] - 1, the values PLCP[p] + 2p
+// are strictly increasing and below 2n, so they are stored as the
+// positions of the set bits in a 2n-bit vector.  PLCP[p] is recovered as
+// select1(p) - 2p, and LCP[i] of the suffix array as PLCP[SA[i+1]].
+// Select uses the position of every SSAMPLE-th set bit followed by a
+// popcount scan, about 2.1 bits per character in total.
+
+#ifndef _compactPLCP_hpp_
+#define _compactPLCP_hpp_
+
+#include <stdio.h>
+#include <stdint.h>
+#include "parallel.h"
+#include "utils.h"
+#define SSAMPLE 256
+using namespace std;
+
+class compactPLCP {
+protected:
+  uint64_t* bits;
+  uintT* samples;
+  long n, nWords, nSamples;
+
+  // position of the set bit of suffix p given its PLCP value
+  static long bitPos(uintT* PLCP, long p) { return PLCP[p] + 2*p; }
+
+  // index of the r-th (from 0) set bit of w
+  static long selectWord(uint64_t w, long r) {
+    for (long k = 0; k < r; k++) w &= w-1;
+    return __builtin_ctzll(w);
+  }
+
+ public:
+  // SA and LCP as returned by suffixArray(s, n, true), i.e. LCP[i] is the
+  // LCP of suffixes SA[i] and SA[i+1].  Neither array is kept.
+  compactPLCP(uintT* SA, uintT* LCP, long _n) {
+    n = _n;
+    nWords = max(1L, (2*n + 63)/64);
+    nSamples = (n + SSAMPLE - 1)/SSAMPLE;
+    bits = newA(uint64_t, nWords);
+    samples = newA(uintT, max(1L, nSamples));
+
+    uintT* PLCP = newA(uintT, n);
+    if (n > 0) PLCP[SA[0]] = 0;
+    parallel_for (long i = 1; i < n; i++) PLCP[SA[i]] = LCP[i-1];
+
+    // Bit positions increase with p, so each word finds its first suffix
+    // by binary search and is filled independently.
+    parallel_for (long w = 0; w < nWords; w++) {
+      long lo = 0, hi = n;
+      while (lo < hi) {
+        long mid = (lo + hi)/2;
+        if (bitPos(PLCP, mid) < 64*w) lo = mid + 1;
+        else hi = mid;
+      }
+      uint64_t word = 0;
+      for (long p = lo; p < n && bitPos(PLCP, p) < 64*(w+1); p++)
+        word |= ((uint64_t) 1) << (bitPos(PLCP, p) - 64*w);
+      bits[w] = word;
+    }
+    parallel_for (long k = 0; k < nSamples; k++)
+      samples[k] = bitPos(PLCP, k*SSAMPLE);
+    free(PLCP);
+  }
+
+  // position of the p-th (from 0) set bit
+  long select(long p) {
+    long pos = samples[p/SSAMPLE];
+    long r = p % SSAMPLE;
+    if (r == 0) return pos;
+    // count the sampled bit itself, then scan whole words
+    long w = pos/64;
+    uint64_t word = bits[w] & (~((uint64_t) 0) << (pos % 64));
+    long c = __builtin_popcountll(word);
+    while (c <= r) {
+      r -= c;
+      word = bits[++w];
+      c = __builtin_popcountll(word);
+    }
+    return 64*w + selectWord(word, r);
+  }
+
+  // LCP of suffix p and its predecessor in the suffix array
+  long plcp(long p) { return select(p) - 2*p; }
+
+  // LCP[i] in the layout of suffixArray(s, n, true)
+  long lcp(uintT* SA, long i) { return (i+1 < n) ? plcp(SA[i+1]) : 0; }
+
+  long size() { return n; }
+
+  long sizeInBytes() {
+    return nWords*sizeof(uint64_t) + nSamples*sizeof(uintT);
+  }
+
+  // Writes n as a 64 bit integer followed by the bit vector words.
+  int write(char* fileName) {
+    FILE* f = fopen(fileName, "wb");
+    if (f == NULL) return 1;
+    int64_t nn = n;
+    int r = (fwrite(&nn, sizeof(int64_t), 1, f) != 1 ||
+             fwrite(bits, sizeof(uint64_t), nWords, f) != (size_t) nWords);
+    return fclose(f) || r;
+  }
+
+  ~compactPLCP() {
+    free(bits);
+    free(samples);
+  }
+};
+
+#endif
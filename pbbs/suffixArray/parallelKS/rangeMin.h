@@ -20,95 +20,193 @@
 // OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
 // WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
+
+// Range minimum queries in constant time, after Fischer and Heun
+// (Theoretical and practical improvements on the RMQ-problem, 2006).
+//
+// The array is cut into groups of RMQ_GROUP elements.  The shape of a
+// group's Cartesian tree (its type, a number below the Catalan number of
+// RMQ_GROUP) decides the position of the minimum of every range inside
+// it, so one shared table of RMQ_GROUP^2 answers per type serves all
+// groups.  The group minima form the next level, cut into groups the same
+// way, for RMQ_LEVELS levels; a sparse table covers the minima of the
+// last level.  A query takes the partial groups at its two ends from the
+// table at each level and the full ones in between from the level above,
+// so it is a constant number of lookups.
+//
+// Types take 16 bits per group at each level and the sparse table
+// log(n) words per RMQ_GROUP^RMQ_LEVELS elements: about 4 bits per element.
+// Ties go to the leftmost position.
+
 #ifndef _myRMQ_hpp_
 #define _myRMQ_hpp_
 
 #include <iostream>
 #include "parallel.h"
 #include "utils.h"
+#include "sequence.h"
 #include "math.h"
-#define BSIZE 128
+#define RMQ_GROUP 8
+#define RMQ_LEVELS 3
+#define RMQ_TYPES 1430 // Catalan number of RMQ_GROUP
 using namespace std;
 
+// In-group answers for every type, built once.
+struct rmqTypeTable {
+  long ballot[RMQ_GROUP+1][RMQ_GROUP+1];
+  unsigned char pos[RMQ_TYPES][RMQ_GROUP][RMQ_GROUP];
+
+  // Enumerates the Cartesian trees of RMQ_GROUP nodes by the pops made
+  // before each push; the minimum of [i, j] is the node of least depth.
+  void fill(long i, long height, long type, long* stack, long* depth) {
+    if (i == RMQ_GROUP) {
+      for (long l = 0; l < RMQ_GROUP; l++) {
+        long m = l;
+        for (long r = l; r < RMQ_GROUP; r++) {
+          if (depth[r] < depth[m]) m = r;
+          pos[type][l][r] = m;
+        }
+      }
+      return;
+    }
+    long q = RMQ_GROUP - i + height;
+    for (long pops = 0; pops <= height; pops++) {
+      // The stack is the right spine, stack[k] at depth k.  Node i takes
+      // the place of the last node popped, whose subtree, everything after
+      // the node below it, moves down under i.
+      long h = height - pops;
+      long first = (h > 0) ? stack[h-1] + 1 : 0;
+      if (pops > 0) for (long x = first; x < i; x++) depth[x]++;
+      long saved = stack[h];
+      stack[h] = i;
+      depth[i] = h;
+      fill(i+1, h+1, type, stack, depth);
+      stack[h] = saved;
+      if (pops > 0) for (long x = first; x < i; x++) depth[x]--;
+      type += ballot[RMQ_GROUP-1-i][q - pops];
+    }
+  }
+
+  rmqTypeTable() {
+    for (long p = 0; p <= RMQ_GROUP; p++)
+      for (long q = 0; q <= RMQ_GROUP; q++)
+        ballot[p][q] = (p == 0 && q == 0) ? 1
+          : (p <= q) ? ((q > 0 ? ballot[p][q-1] : 0) + (p > 0 ? ballot[p-1][q] : 0))
+          : 0;
+    long stack[RMQ_GROUP], depth[RMQ_GROUP];
+    fill(0, 0, 0, stack, depth);
+  }
+
+  static rmqTypeTable& get() {
+    static rmqTypeTable table;
+    return table;
+  }
+};
+
 class myRMQ {
 protected:
   uintT* a;
-  uintT** table;
-  long n, m, depth;
+  long n;
+  long sizes[RMQ_LEVELS+1];   // units at each level, elements at level 0
+  unsigned short* types[RMQ_LEVELS];
+  uintT* table;               // sparse table, depth rows of m positions
+  long m, depth;
+  rmqTypeTable* T;
+
+  // leftmost minimum of the values of a at positions x and y, x < y
+  long better(long x, long y) { return a[y] < a[x] ? y : x; }
+
+  // position in a of the minimum of unit u of level l
+  long unitMin(long l, long u) {
+    for (; l > 0; l--) {
+      long len = min((long) RMQ_GROUP, sizes[l-1] - u*RMQ_GROUP);
+      u = u*RMQ_GROUP + T->pos[types[l-1][u]][0][len-1];
+    }
+    return u;
+  }
+
+  // position in a of the minimum of units [i, j] of level l, i <= j
+  long levelQuery(long l, long i, long j) {
+    if (l == RMQ_LEVELS) {
+      long k = 63 - __builtin_clzl(j - i + 1);
+      return better(table[k*m + i], table[k*m + j + 1 - (1L << k)]);
+    }
+    long gi = i/RMQ_GROUP, gj = j/RMQ_GROUP;
+    if (gi == gj)
+      return unitMin(l, gi*RMQ_GROUP +
+                     T->pos[types[l][gi]][i%RMQ_GROUP][j%RMQ_GROUP]);
+    long r = unitMin(l, gi*RMQ_GROUP +
+                     T->pos[types[l][gi]][i%RMQ_GROUP][RMQ_GROUP-1]);
+    if (gj > gi+1) r = better(r, levelQuery(l+1, gi+1, gj-1));
+    return better(r, unitMin(l, gj*RMQ_GROUP +
+                             T->pos[types[l][gj]][0][j%RMQ_GROUP]));
+  }
 
  public:
-  myRMQ(uintT* _a, long _n){
+  myRMQ(uintT* _a, long _n) {
     a = _a;
     n = _n;
-    m = 1 + (n-1)/BSIZE;
+    T = &rmqTypeTable::get();
     precomputeQueries();
   }
 
   void precomputeQueries() {
-    depth = utils::log2Up(m+1);
-    table = newA(uintT*, depth);
-    parallel_for(long k=0; k<depth; k++)
-      table[k] = newA(uintT, m);
-    parallel_for(long i=0; i < m; i++) {
-      long start = i*BSIZE;
-      long end = min(start+BSIZE,n);
-      long k = i*BSIZE;
-      for (long j = start+1; j < end; j++) 
-	if (a[j] < a[k]) k = j;
-      table[0][i] = k;
+    // positions of the minima of the units at the current level
+    uintT* at = NULL;
+    sizes[0] = n;
+    for (long l = 0; l < RMQ_LEVELS; l++) {
+      long g = nblocks(sizes[l], RMQ_GROUP);
+      sizes[l+1] = g;
+      types[l] = newA(unsigned short, max(1L, g));
+      uintT* next = newA(uintT, max(1L, g));
+      parallel_for (long b = 0; b < g; b++) {
+        long s = b*RMQ_GROUP, len = min((long) RMQ_GROUP, sizes[l] - s);
+        long stack[RMQ_GROUP];
+        long h = 0, q = RMQ_GROUP, type = 0;
+        for (long i = 0; i < len; i++) {
+          uintT v = a[at ? at[s+i] : s+i];
+          while (h > 0 && a[at ? at[s+stack[h-1]] : s+stack[h-1]] > v) {
+            type += T->ballot[RMQ_GROUP-1-i][q];
+            q--;
+            h--;
+          }
+          stack[h++] = i;
+        }
+        types[l][b] = type;
+        long p = s + T->pos[type][0][len-1];
+        next[b] = at ? at[p] : p;
+      }
+      if (at) free(at);
+      at = next;
     }
 
+    m = sizes[RMQ_LEVELS];
+    depth = max(1, (int) utils::log2Up(m+1));
+    table = newA(uintT, max(1L, m*depth));
+    parallel_for (long i = 0; i < m; i++) table[i] = at[i];
+    free(at);
     long dist = 1;
-    for (long j=1; j<depth; j++) {
-      parallel_for (long i=0; i < m-dist; i++) {
-	if (a[table[j-1][i]] <= a[table[j-1][i+dist]])
-	  table[j][i] = table[j-1][i];
-	else table[j][i] = table[j-1][i+dist];
-      }
-      parallel_for (long l = m-dist; l<m; l++)
-	table[j][l] = table[j-1][l];
-      dist*=2;
+    for (long k = 1; k < depth; k++) {
+      uintT* prev = table + (k-1)*m;
+      uintT* cur = table + k*m;
+      parallel_for (long i = 0; i < m; i++)
+        cur[i] = (i + dist < m) ? better(prev[i], prev[i+dist]) : prev[i];
+      dist *= 2;
     }
   }
 
-  long query(long i, long j) {
-    //same block
-    if (j-i < BSIZE) {
-      long r = i;
-      for (long k = i+1; k <= j; k++) 
-	if (a[k] < a[r]) r = k;
-      return r;
-    } 
-    long block_i = i/BSIZE;
-    long block_j = j/BSIZE;
-    long min = i;
-    for (long k=i+1; k < (block_i+1)*BSIZE; k++)
-      if(a[k] < a[min]) min = k;
-    for (long k=j; k>=(block_j)*BSIZE; k--)
-      if(a[k] < a[min]) min = k;
-    if (block_j == block_i + 1) return min;
-    long outOfBlockMin;
-
-    //not same or adjacent blocks
-    if (block_j > block_i + 1) {
-      block_i++;
-      block_j--;
-      if (block_j == block_i) 
-	outOfBlockMin = table[0][block_i];
-      else if(block_j == block_i + 1) 
-	outOfBlockMin = table[1][block_i];
-      else {
-	long k = utils::log2Up(block_j - block_i+1)-1;
-	long p = 1<<k; //2^k
-	outOfBlockMin = a[table[k][block_i]] <= a[table[k][block_j+1-p]]
-	  ? table[k][block_i] : table[k][block_j+1-p];
-      }
-    }
-    return a[min] < a[outOfBlockMin] ? min : outOfBlockMin;
+  // position of the minimum of a[i..j], i <= j
+  long query(long i, long j) { return levelQuery(0, i, j); }
+
+  long sizeInBytes() {
+    long s = m*depth*sizeof(uintT);
+    for (long l = 0; l < RMQ_LEVELS; l++)
+      s += sizes[l+1]*sizeof(unsigned short);
+    return s;
   }
 
   ~myRMQ() {
-    parallel_for(long i=0;i<depth;i++) free(table[i]);
+    for (long l = 0; l < RMQ_LEVELS; l++) free(types[l]);
     free(table);
   }
 };
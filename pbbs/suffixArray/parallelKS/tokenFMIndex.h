@@ -0,0 +1,96 @@
+// This code is part of the Problem Based Benchmark Suite (PBBS)
+// Copyright (c) 2011 Guy Blelloch and the PBBS team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// FM-index over token sequences (integer symbols, e.g. 32-bit word ids)
+// with the BWT held in a wavelet matrix, so occurrence counts take
+// n log sigma bits instead of a table per symbol.
+//
+// Rows 0..n are the sorted suffixes of s$, row 0 being $ alone, so row
+// i+1 is SA[i] for SA as returned by suffixArrayTokens.  In the BWT token
+// t is stored as t+1 and $ as 0.
+
+#ifndef _TOKEN_FM_INDEX_hpp_
+#define _TOKEN_FM_INDEX_hpp_
+
+#include "parallel.h"
+#include "utils.h"
+#include "sequence.h"
+#include "waveletMatrix.h"
+using namespace std;
+
+class tokenFMIndex {
+protected:
+  long n, sigma;
+  uintT* C;  // first row of each BWT symbol, sigma+1 entries
+  waveletMatrix* W;
+
+ public:
+  tokenFMIndex(uintT* s, uintT* SA, long _n) : n(_n) {
+    uintT* L = newA(uintT, n+1);
+    L[0] = (n > 0) ? s[n-1] + 1 : 0;
+    parallel_for (long i = 0; i < n; i++)
+      L[i+1] = (SA[i] == 0) ? 0 : s[SA[i]-1] + 1;
+    sigma = 1 + sequence::reduce(L, n+1, utils::maxF<uintT>());
+    W = new waveletMatrix(L, n+1, sigma);
+    free(L);
+
+    // suffixes are sorted by first token, so each symbol's rows start
+    // where the first token changes
+    C = newA(uintT, sigma+1);
+    parallel_for (long c = 0; c <= sigma; c++) C[c] = n+1;
+    C[0] = 0;
+    parallel_for (long i = 0; i < n; i++)
+      if (i == 0 || s[SA[i]] != s[SA[i-1]]) C[s[SA[i]] + 1] = i+1;
+    for (long c = sigma-1; c > 0; c--) C[c] = min(C[c], C[c+1]);
+  }
+
+  long size() { return n; }
+
+  // SA interval [i..j) of the suffixes starting with P[0..m)
+  bool find(uintT* P, long m, long& i, long& j) {
+    long sp = 0, ep = n+1;
+    for (long k = m-1; k >= 0; k--) {
+      if ((long) P[k] + 1 >= sigma) { i = j = 0; return false; }
+      uintT c = P[k] + 1;
+      sp = C[c] + W->rank(c, sp);
+      ep = C[c] + W->rank(c, ep);
+      if (sp >= ep) { i = j = 0; return false; }
+    }
+    if (m == 0) sp = 1;
+    i = sp - 1;
+    j = ep - 1;
+    return true;
+  }
+
+  long count(uintT* P, long m) {
+    long i, j;
+    return find(P, m, i, j) ? j - i : 0;
+  }
+
+  long sizeInBytes() {
+    return W->sizeInBytes() + (sigma+1)*sizeof(uintT);
+  }
+
+  ~tokenFMIndex() { delete W; free(C); }
+};
+
+#endif
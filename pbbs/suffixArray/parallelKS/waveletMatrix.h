@@ -0,0 +1,182 @@
+// This code is part of the Problem Based Benchmark Suite (PBBS)
+// Copyright (c) 2011 Guy Blelloch and the PBBS team
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Wavelet matrix (Claude, Navarro and Ordonez, The wavelet matrix, 2015)
+// over integer symbols in [0, sigma).  Level d holds bit d of every
+// symbol, most significant first, in the order left by stably moving the
+// zeros ahead of the ones at all earlier levels; Z[d] is the number of
+// zeros.  Each level is built with one parallel pass and two packs.
+//
+// Levels are plain bit vectors with a count of ones before every block of
+// WM_BLOCK words, so rank is a lookup plus at most WM_BLOCK popcounts and
+// select a binary search over the blocks.  Space is n log sigma bits plus
+// the counts.
+
+#ifndef _WAVELET_MATRIX_hpp_
+#define _WAVELET_MATRIX_hpp_
+
+#include "parallel.h"
+#include "utils.h"
+#include "sequence.h"
+#define WM_BLOCK 8
+using namespace std;
+
+typedef unsigned long long wmWord;
+
+class waveletMatrix {
+protected:
+  long n, levels;
+  wmWord** bits;
+  uintT** ones;  // ones before each block of WM_BLOCK words
+  long* Z;
+
+  bool bit(long d, long i) { return (bits[d][i/64] >> (i%64)) & 1; }
+
+  long rank1(long d, long i) {
+    long w = i/64, b = w/WM_BLOCK;
+    long r = ones[d][b];
+    for (long k = b*WM_BLOCK; k < w; k++) r += __builtin_popcountll(bits[d][k]);
+    if (i%64) r += __builtin_popcountll(bits[d][w] << (64 - i%64));
+    return r;
+  }
+
+  long rank0(long d, long i) { return i - rank1(d, i); }
+
+  // position of the k-th (from 0) one, or zero if !one
+  long select(long d, long k, bool one) {
+    long nb = nblocks(nblocks(n, 64), WM_BLOCK);
+    long lo = 0, hi = nb;
+    while (hi - lo > 1) {
+      long mid = (lo + hi)/2;
+      long c = one ? ones[d][mid] : (long) mid*WM_BLOCK*64 - ones[d][mid];
+      if (c <= k) lo = mid; else hi = mid;
+    }
+    k -= one ? ones[d][lo] : (long) lo*WM_BLOCK*64 - ones[d][lo];
+    for (long w = lo*WM_BLOCK; ; w++) {
+      wmWord x = one ? bits[d][w] : ~bits[d][w];
+      long c = __builtin_popcountll(x);
+      if (k < c) {
+        for (; k > 0; k--) x &= x - 1;
+        return w*64 + __builtin_ctzll(x);
+      }
+      k -= c;
+    }
+  }
+
+ public:
+  // Symbols of A must be below sigma.
+  waveletMatrix(uintT* A, long _n, long sigma) : n(_n) {
+    levels = max(1, (int) utils::log2Up(sigma));
+    long nw = nblocks(n, 64), nb = nblocks(nw, WM_BLOCK);
+    bits = newA(wmWord*, levels);
+    ones = newA(uintT*, levels);
+    Z = newA(long, levels);
+    uintT* cur = newA(uintT, n);
+    uintT* next = newA(uintT, n);
+    bool* isOne = newA(bool, n);
+    bool* isZero = newA(bool, n);
+    parallel_for (long i = 0; i < n; i++) cur[i] = A[i];
+
+    for (long d = 0; d < levels; d++) {
+      long shift = levels - 1 - d;
+      parallel_for (long i = 0; i < n; i++) {
+        isOne[i] = (cur[i] >> shift) & 1;
+        isZero[i] = !isOne[i];
+      }
+      wmWord* B = bits[d] = newA(wmWord, nw + 1);
+      parallel_for (long w = 0; w <= nw; w++) {
+        wmWord x = 0;
+        long e = min(w*64 + 64, n);
+        for (long i = w*64; i < e; i++) x |= (wmWord) isOne[i] << (i%64);
+        B[w] = x;
+      }
+      uintT* O = ones[d] = newA(uintT, nb + 1);
+      parallel_for (long b = 0; b < nb; b++) {
+        long c = 0, e = min((b+1)*WM_BLOCK, nw);
+        for (long w = b*WM_BLOCK; w < e; w++) c += __builtin_popcountll(B[w]);
+        O[b] = c;
+      }
+      O[nb] = 0;
+      sequence::plusScan(O, O, nb + 1);
+
+      // stable partition, zeros first
+      Z[d] = sequence::pack(cur, next, isZero, n);
+      sequence::pack(cur, next + Z[d], isOne, n);
+      swap(cur, next);
+    }
+    free(cur); free(next); free(isOne); free(isZero);
+  }
+
+  long size() { return n; }
+
+  uintT access(long i) {
+    uintT c = 0;
+    for (long d = 0; d < levels; d++) {
+      bool b = bit(d, i);
+      c = (c << 1) | b;
+      i = b ? Z[d] + rank1(d, i) : rank0(d, i);
+    }
+    return c;
+  }
+
+  // occurrences of c in A[0..i)
+  long rank(uintT c, long i) {
+    long p = 0;
+    for (long d = 0; d < levels; d++) {
+      if ((c >> (levels - 1 - d)) & 1) {
+        p = Z[d] + rank1(d, p);
+        i = Z[d] + rank1(d, i);
+      } else {
+        p = rank0(d, p);
+        i = rank0(d, i);
+      }
+    }
+    return i - p;
+  }
+
+  // position of the k-th (from 0) occurrence of c, k < rank(c, n)
+  long select(uintT c, long k) {
+    long p = 0;
+    for (long d = 0; d < levels; d++) {
+      if ((c >> (levels - 1 - d)) & 1) p = Z[d] + rank1(d, p);
+      else p = rank0(d, p);
+    }
+    long i = p + k;
+    for (long d = levels - 1; d >= 0; d--) {
+      if ((c >> (levels - 1 - d)) & 1) i = select(d, i - Z[d], true);
+      else i = select(d, i, false);
+    }
+    return i;
+  }
+
+  long sizeInBytes() {
+    long nw = nblocks(n, 64), nb = nblocks(nw, WM_BLOCK);
+    return levels * ((nw + 1)*sizeof(wmWord) + (nb + 1)*sizeof(uintT));
+  }
+
+  ~waveletMatrix() {
+    for (long d = 0; d < levels; d++) { free(bits[d]); free(ones[d]); }
+    free(bits); free(ones); free(Z);
+  }
+};
+
+#endif
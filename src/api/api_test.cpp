@@ -0,0 +1,215 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "suffix_array_api.h"
+
+using namespace std;
+
+// Checks the library against a plain sort of the suffixes. Run it under
+// mpirun with any number of processes; the single-process builds run on
+// process 0 and the distributed ones on all of them.
+
+static const unsigned char* sort_text;
+static uint64_t sort_size;
+
+static bool suffix_less(uint32_t a, uint32_t b) {
+  return lexicographical_compare(sort_text + a, sort_text + sort_size,
+                                 sort_text + b, sort_text + sort_size);
+}
+
+static vector<uint32_t> naive_suffix_array(const string& text) {
+  sort_text = reinterpret_cast<const unsigned char*>(text.data());
+  sort_size = text.size();
+  vector<uint32_t> sa(text.size());
+  for (uint32_t i = 0; i < sa.size(); i++) {
+    sa[i] = i;
+  }
+  sort(sa.begin(), sa.end(), suffix_less);
+  return sa;
+}
+
+static string random_text(uint64_t n, int alphabet) {
+  string text(n, 'a');
+  for (uint64_t i = 0; i < n; i++) {
+    text[i] = 'a' + rand() % alphabet;
+  }
+  return text;
+}
+
+// Whether result holds the outputs of text, whose suffix array is sa.
+static bool check_result(const string& text, const vector<uint32_t>& sa,
+                         const sa_result& result, uint32_t outputs) {
+  const uint64_t n = text.size();
+  bool ok = true;
+  for (uint64_t i = 0; i < n; i++) {
+    if ((outputs & SA_OUTPUT_SA) && result.suffix_array[i] != sa[i]) {
+      ok = false;
+    }
+    if ((outputs & SA_OUTPUT_ISA) &&
+        result.inverse_suffix_array[sa[i]] != i) {
+      ok = false;
+    }
+    if (outputs & SA_OUTPUT_LCP) {
+      uint32_t h = 0;
+      while (i > 0 && sa[i] + h < n && sa[i - 1] + h < n &&
+             text[sa[i] + h] == text[sa[i - 1] + h]) {
+        h++;
+      }
+      ok = ok && result.lcp[i] == h;
+    }
+    if (outputs & SA_OUTPUT_BWT) {
+      const unsigned char c = sa[i] == 0 ? 0 : text[sa[i] - 1];
+      ok = ok && result.bwt[i + 1] == c;
+      ok = ok && (sa[i] != 0 || result.primary == i + 1);
+    }
+  }
+  if ((outputs & SA_OUTPUT_BWT) && n > 0) {
+    ok = ok && result.bwt[0] == static_cast<unsigned char>(text[n - 1]);
+  }
+  return ok;
+}
+
+static int32_t test_single(sa_engine engine, uint64_t n, int alphabet) {
+  const string text = random_text(n, alphabet);
+  const uint32_t outputs =
+      SA_OUTPUT_SA | SA_OUTPUT_ISA | SA_OUTPUT_LCP | SA_OUTPUT_BWT;
+  sa_result result;
+  memset(&result, 0, sizeof(result));
+  // Odd sizes go to a buffer of the caller's.
+  vector<uint32_t> suffix_array(n);
+  if (n % 2) {
+    result.suffix_array = suffix_array.data();
+  }
+  const int32_t status =
+      sa_build(reinterpret_cast<const unsigned char*>(text.data()), n,
+               engine, outputs, &result);
+  const bool ok =
+      status == 0 &&
+      check_result(text, naive_suffix_array(text), result, outputs);
+  sa_result_free(&result);
+  if (!ok) {
+    fprintf(stderr, "sa_build engine %d n %lu alphabet %d failed\n", engine,
+            n, alphabet);
+    return -1;
+  }
+  return 0;
+}
+
+// Builds text over comm and checks the gathered arrays on process 0. Blocks
+// of fewer than 3 characters must fail on every process instead.
+static int32_t test_distributed(uint64_t n, int alphabet) {
+  int numprocs, myid;
+  MPI_Comm_size(MPI_COMM_WORLD, &numprocs);
+  MPI_Comm_rank(MPI_COMM_WORLD, &myid);
+  // Same text everywhere.
+  srand(static_cast<unsigned>(n * 31 + alphabet));
+  const string text = random_text(n, alphabet);
+
+  uint64_t offset, size;
+  sa_block_range(n, numprocs, myid, &offset, &size);
+  int small = size < 3;
+  MPI_Allreduce(MPI_IN_PLACE, &small, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+  const string block =
+      offset < n ? text.substr(offset, min<uint64_t>(size + 2, n - offset))
+                 : string();
+
+  const uint32_t outputs = SA_OUTPUT_SA | SA_OUTPUT_ISA | SA_OUTPUT_BWT;
+  sa_result result;
+  memset(&result, 0, sizeof(result));
+  const int32_t status = sa_build_distributed(
+      reinterpret_cast<const unsigned char*>(block.data()), size, offset, n,
+      MPI_COMM_WORLD, outputs, &result);
+
+  int ok = status == (small ? -1 : 0);
+  if (status == 0) {
+    vector<int> counts(numprocs), displs(numprocs);
+    vector<int> bwt_counts(numprocs), bwt_displs(numprocs);
+    const int count = static_cast<int>(size);
+    MPI_Allgather(&count, 1, MPI_INT, counts.data(), 1, MPI_INT,
+                  MPI_COMM_WORLD);
+    for (int i = 0; i < numprocs; i++) {
+      bwt_counts[i] = counts[i] + (i == 0);
+      if (i > 0) {
+        displs[i] = displs[i - 1] + counts[i - 1];
+        bwt_displs[i] = bwt_displs[i - 1] + bwt_counts[i - 1];
+      }
+    }
+    vector<uint32_t> suffix_array(n), inverse_suffix_array(n);
+    vector<unsigned char> bwt(n + 1);
+    MPI_Gatherv(result.suffix_array, count, MPI_UNSIGNED,
+                suffix_array.data(), counts.data(), displs.data(),
+                MPI_UNSIGNED, 0, MPI_COMM_WORLD);
+    MPI_Gatherv(result.inverse_suffix_array, count, MPI_UNSIGNED,
+                inverse_suffix_array.data(), counts.data(), displs.data(),
+                MPI_UNSIGNED, 0, MPI_COMM_WORLD);
+    MPI_Gatherv(result.bwt, count + (myid == 0), MPI_UNSIGNED_CHAR,
+                bwt.data(), bwt_counts.data(), bwt_displs.data(),
+                MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
+    if (myid == 0) {
+      sa_result all;
+      memset(&all, 0, sizeof(all));
+      all.suffix_array = suffix_array.data();
+      all.inverse_suffix_array = inverse_suffix_array.data();
+      all.bwt = bwt.data();
+      all.primary = result.primary;
+      ok = check_result(text, naive_suffix_array(text), all, outputs);
+    }
+  }
+  sa_result_free(&result);
+  MPI_Bcast(&ok, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  if (!ok) {
+    if (myid == 0) {
+      fprintf(stderr, "sa_build_distributed p %d n %lu alphabet %d failed\n",
+              numprocs, n, alphabet);
+    }
+    return -1;
+  }
+  return 0;
+}
+
+int main(int argc, char* argv[]) {
+  MPI_Init(&argc, &argv);
+  int numprocs, myid;
+  MPI_Comm_size(MPI_COMM_WORLD, &numprocs);
+  MPI_Comm_rank(MPI_COMM_WORLD, &myid);
+  // The builders report progress on stdout.
+  if (freopen("/dev/null", "w", stdout) == NULL) {
+    return 1;
+  }
+
+  const uint64_t sizes[] = {0, 1, 2, 3, 4, 5, 17, 64, 65, 100, 1000, 70000};
+  const int alphabets[] = {1, 2, 4, 26};
+  int failures = 0;
+  if (myid == 0) {
+    srand(7);
+    for (int engine = SA_ENGINE_AUTO; engine <= SA_ENGINE_DC3; engine++) {
+      for (uint64_t n : sizes) {
+        for (int alphabet : alphabets) {
+          failures += test_single(static_cast<sa_engine>(engine), n,
+                                  alphabet) < 0;
+        }
+      }
+    }
+  }
+  // Every size up to where all blocks have 3 characters, and some beyond.
+  for (uint64_t n = 1; n <= 4 * static_cast<uint64_t>(numprocs) + 8; n++) {
+    failures += test_distributed(n, 3) < 0;
+  }
+  for (uint64_t n : {1000ul, 100001ul}) {
+    for (int alphabet : {2, 26}) {
+      failures += test_distributed(n, alphabet) < 0;
+    }
+  }
+
+  int all_failures = 0;
+  MPI_Allreduce(&failures, &all_failures, 1, MPI_INT, MPI_SUM,
+                MPI_COMM_WORLD);
+  if (myid == 0) {
+    fprintf(stderr, "%d failed\n", all_failures);
+  }
+  MPI_Finalize();
+  return all_failures == 0 ? 0 : 1;
+}
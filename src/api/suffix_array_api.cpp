@@ -0,0 +1,271 @@
+#include "suffix_array_api.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <algorithm>
+#include "../batch/batch_sa.h"
+#include "../io/fileio.h"
+#include "../sais/sais.h"
+#include "../simd/mismatch.h"
+#include "../suffix_array/distributed_bwt.h"
+#include "../suffix_array/suffix_array.h"
+
+// Text positions per task of the LCP pass.
+const uint64_t LCP_CHUNK = 1 << 16;
+
+// Smallest block DC3 handles: it counts on two positions not 0 mod 3 in
+// every block, which three consecutive positions always have.
+const uint64_t DC3_MIN_BLOCK = 3;
+
+// Points out at a malloc'ed buffer of count elements unless the caller gave
+// one, and marks it as the library's.
+template <typename T>
+static int32_t output_buffer(T*& out, uint64_t count, uint32_t output,
+                             sa_result* result) {
+  if (out != NULL) {
+    return 0;
+  }
+  out = static_cast<T*>(malloc(std::max<uint64_t>(count, 1) * sizeof(T)));
+  if (out == NULL) {
+    return -1;
+  }
+  result->allocated |= output;
+  return 0;
+}
+
+// Buffers for the requested outputs; the suffix array and the inverse
+// suffix array are needed by the others and go to scratch otherwise.
+static int32_t output_buffers(uint64_t n, uint64_t bwt_rows, uint32_t outputs,
+                              bool need_isa, sa_result* result,
+                              uint32_t*& suffix_array,
+                              uint32_t*& inverse_suffix_array) {
+  suffix_array = NULL;
+  inverse_suffix_array = NULL;
+  if (((outputs & SA_OUTPUT_SA) &&
+       output_buffer(result->suffix_array, n, SA_OUTPUT_SA, result) < 0) ||
+      ((outputs & SA_OUTPUT_ISA) &&
+       output_buffer(result->inverse_suffix_array, n, SA_OUTPUT_ISA,
+                     result) < 0) ||
+      ((outputs & SA_OUTPUT_LCP) &&
+       output_buffer(result->lcp, n, SA_OUTPUT_LCP, result) < 0) ||
+      ((outputs & SA_OUTPUT_BWT) &&
+       output_buffer(result->bwt, bwt_rows, SA_OUTPUT_BWT, result) < 0)) {
+    return -1;
+  }
+  suffix_array = (outputs & SA_OUTPUT_SA)
+                     ? result->suffix_array
+                     : static_cast<uint32_t*>(malloc(
+                           std::max<uint64_t>(n, 1) * sizeof(uint32_t)));
+  if (suffix_array == NULL) {
+    return -1;
+  }
+  if (outputs & SA_OUTPUT_ISA) {
+    inverse_suffix_array = result->inverse_suffix_array;
+  } else if (need_isa) {
+    inverse_suffix_array = static_cast<uint32_t*>(
+        malloc(std::max<uint64_t>(n, 1) * sizeof(uint32_t)));
+    if (inverse_suffix_array == NULL) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+static void release_scratch(uint32_t outputs, uint32_t* suffix_array,
+                            uint32_t* inverse_suffix_array) {
+  if (!(outputs & SA_OUTPUT_SA)) {
+    free(suffix_array);
+  }
+  if (!(outputs & SA_OUTPUT_ISA)) {
+    free(inverse_suffix_array);
+  }
+}
+
+// Kasai et al. by way of the permuted LCP array (Karkkainen, Manzini and
+// Puglisi): the LCP of the suffix at i with the one before it in suffix
+// order is at least that of i - 1 less one, so a pass in text order only
+// compares O(n) characters. Chunks of the text run in parallel, each
+// starting from 0.
+static int32_t lcp_array(const unsigned char* text, uint64_t n,
+                         const uint32_t* suffix_array, uint32_t* lcp) {
+  if (n == 0) {
+    return 0;
+  }
+  uint32_t* plcp = static_cast<uint32_t*>(malloc(n * sizeof(uint32_t)));
+  if (plcp == NULL) {
+    return -1;
+  }
+  // The suffix before each one in suffix order, n for the smallest.
+  plcp[suffix_array[0]] = static_cast<uint32_t>(n);
+#pragma omp parallel for
+  for (uint64_t i = 1; i < n; i++) {
+    plcp[suffix_array[i]] = suffix_array[i - 1];
+  }
+#pragma omp parallel for schedule(dynamic, 1)
+  for (uint64_t chunk = 0; chunk < n; chunk += LCP_CHUNK) {
+    const uint64_t end = std::min(chunk + LCP_CHUNK, n);
+    uint64_t h = 0;
+    for (uint64_t i = chunk; i < end; i++) {
+      const uint64_t j = plcp[i];
+      if (j == n) {
+        plcp[i] = 0;
+        h = 0;
+        continue;
+      }
+      h += mismatch_bytes(text + i + h, text + j + h,
+                          n - std::max(i, j) - h);
+      plcp[i] = static_cast<uint32_t>(h);
+      if (h > 0) h--;
+    }
+  }
+#pragma omp parallel for
+  for (uint64_t i = 0; i < n; i++) {
+    lcp[i] = plcp[suffix_array[i]];
+  }
+  free(plcp);
+  return 0;
+}
+
+int32_t sa_build(const unsigned char* text, uint64_t n, sa_engine engine,
+                 uint32_t outputs, sa_result* result) {
+  if (n > INT_MAX) {
+    return -1;
+  }
+  int initialized = 0;
+  if (engine == SA_ENGINE_DC3 &&
+      (MPI_Initialized(&initialized) != MPI_SUCCESS || !initialized)) {
+    return -1;
+  }
+  uint32_t* suffix_array;
+  uint32_t* inverse_suffix_array;
+  int32_t status = output_buffers(n, n + 1, outputs, false, result,
+                                  suffix_array, inverse_suffix_array);
+  if (status == 0) {
+    const uint32_t size = static_cast<uint32_t>(n);
+    // Texts too short for a DC3 block are sorted directly.
+    if (engine == SA_ENGINE_DC3 && n >= DC3_MIN_BLOCK) {
+      // The view ends the text at n, so DC3 reads no lookahead past it.
+      const text_view view = {reinterpret_cast<const char*>(text), 0, 1, n};
+      SuffixArray st;
+      status = st.build(view, size, size + 1, 0, 1, 0, suffix_array,
+                        inverse_suffix_array, MPI_COMM_SELF);
+    } else if (engine == SA_ENGINE_SAIS) {
+      status = sais(text, reinterpret_cast<int*>(suffix_array),
+                    static_cast<int>(size)) == 0 ? 0 : -1;
+      if (status == 0 && inverse_suffix_array != NULL) {
+#pragma omp parallel for
+        for (uint64_t i = 0; i < n; i++) {
+          inverse_suffix_array[suffix_array[i]] = static_cast<uint32_t>(i);
+        }
+      }
+    } else {
+      status = text_suffix_array(text, size, suffix_array);
+      if (status == 0 && inverse_suffix_array != NULL) {
+#pragma omp parallel for
+        for (uint64_t i = 0; i < n; i++) {
+          inverse_suffix_array[suffix_array[i]] = static_cast<uint32_t>(i);
+        }
+      }
+    }
+  }
+  if (status == 0 && (outputs & SA_OUTPUT_LCP)) {
+    status = lcp_array(text, n, suffix_array, result->lcp);
+  }
+  if (status == 0 && (outputs & SA_OUTPUT_BWT)) {
+    // Row i + 1 is suffix array index i; row 0 is $ and ends with the text.
+    unsigned char* bwt = result->bwt;
+    bwt[0] = n > 0 ? text[n - 1] : 0;
+    result->primary = 0;
+#pragma omp parallel for
+    for (uint64_t i = 0; i < n; i++) {
+      bwt[i + 1] = suffix_array[i] == 0 ? 0 : text[suffix_array[i] - 1];
+      if (suffix_array[i] == 0) result->primary = i + 1;
+    }
+  }
+  release_scratch(outputs, suffix_array, inverse_suffix_array);
+  if (status < 0) {
+    sa_result_free(result);
+    return -1;
+  }
+  return 0;
+}
+
+void sa_block_range(uint64_t n, int p, int rank, uint64_t* offset,
+                    uint64_t* size) {
+  // The driver's split of a file of n characters and a terminator.
+  block_range(n + 1, p, rank, 1, *offset, *size);
+}
+
+int32_t sa_build_distributed(const unsigned char* block, uint64_t size,
+                             uint64_t offset, uint64_t n, MPI_Comm comm,
+                             uint32_t outputs, sa_result* result) {
+  int numprocs, myid;
+  MPI_Comm_size(comm, &numprocs);
+  MPI_Comm_rank(comm, &myid);
+  uint64_t expected_offset = 0, expected_size = 0;
+  sa_block_range(n, numprocs, myid, &expected_offset, &expected_size);
+
+  int32_t status = 0;
+  if (n >= UINT32_MAX || (outputs & SA_OUTPUT_LCP) ||
+      size < DC3_MIN_BLOCK || offset != expected_offset ||
+      size != expected_size) {
+    status = -1;
+  }
+  uint32_t* suffix_array = NULL;
+  uint32_t* inverse_suffix_array = NULL;
+  if (status == 0) {
+    status = output_buffers(size, size + (myid == 0 ? 1 : 0), outputs,
+                            (outputs & SA_OUTPUT_BWT) != 0, result,
+                            suffix_array, inverse_suffix_array);
+  }
+  int32_t all_status = status;
+  MPI_Allreduce(&status, &all_status, 1, MPI_INT, MPI_MIN, comm);
+
+  // Reads past the end of the text give 0, so the block needs no padding.
+  const text_view view = {reinterpret_cast<const char*>(block), 0, 1,
+                          n - offset};
+  if (all_status == 0) {
+    SuffixArray st;
+    status = st.build(view, static_cast<uint32_t>(size),
+                      static_cast<uint32_t>(n + 1),
+                      static_cast<uint32_t>(offset), numprocs, myid,
+                      suffix_array, inverse_suffix_array, comm);
+    MPI_Allreduce(&status, &all_status, 1, MPI_INT, MPI_MIN, comm);
+  }
+  if (all_status == 0 && (outputs & SA_OUTPUT_BWT)) {
+    uint32_t primary = 0;
+    status = distributed_bwt(view, static_cast<uint32_t>(size),
+                             static_cast<uint32_t>(offset),
+                             inverse_suffix_array,
+                             reinterpret_cast<char*>(result->bwt), primary,
+                             comm);
+    result->primary = primary;
+    MPI_Allreduce(&status, &all_status, 1, MPI_INT, MPI_MIN, comm);
+  }
+  release_scratch(outputs, suffix_array, inverse_suffix_array);
+  if (all_status < 0) {
+    sa_result_free(result);
+    return -1;
+  }
+  return 0;
+}
+
+void sa_result_free(sa_result* result) {
+  if (result->allocated & SA_OUTPUT_SA) {
+    free(result->suffix_array);
+    result->suffix_array = NULL;
+  }
+  if (result->allocated & SA_OUTPUT_ISA) {
+    free(result->inverse_suffix_array);
+    result->inverse_suffix_array = NULL;
+  }
+  if (result->allocated & SA_OUTPUT_LCP) {
+    free(result->lcp);
+    result->lcp = NULL;
+  }
+  if (result->allocated & SA_OUTPUT_BWT) {
+    free(result->bwt);
+    result->bwt = NULL;
+  }
+  result->allocated = 0;
+}
@@ -0,0 +1,89 @@
+#ifndef __SUFFIX_ARRAY_API__
+#define __SUFFIX_ARRAY_API__
+
+#include <stdint.h>
+#include "mpi.h"
+
+/*
+ * Library interface to the builders for programs that want the arrays in
+ * memory instead of in files: libsuffixarray.a or libsuffixarray.so, built
+ * by the Makefile next to this header. Plain C so other languages can bind
+ * to it.
+ *
+ * The text stays in the caller's buffer and is never copied. Each output
+ * goes to the buffer the caller put in the result, or, where that pointer
+ * is NULL, to one the library allocates with malloc and marks in allocated;
+ * sa_result_free releases those. Either way the builders write straight
+ * into it. A result must therefore start out zeroed, apart from the buffers
+ * the caller sets.
+ *
+ * Suffix array and inverse suffix array are 32-bit positions and ranks.
+ * lcp[i] is the longest common prefix of the suffixes at suffix array
+ * indices i - 1 and i, with lcp[0] = 0. The BWT has the n + 1 rows of the
+ * sorted suffixes of text$, row 0 being $ alone, as distributed_bwt lays
+ * them out; primary is the row of the whole text, which stands for $ and
+ * holds 0.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+  // Sorting for short texts, SA-IS above BATCH_SORT_MAX characters.
+  SA_ENGINE_AUTO = 0,
+  SA_ENGINE_SAIS = 1,
+  // The distributed DC3 builder on MPI_COMM_SELF. Needs MPI initialized and
+  // a text without zero bytes, which it reads as the end of the text.
+  SA_ENGINE_DC3 = 2
+} sa_engine;
+
+// Outputs to build, or-ed together.
+#define SA_OUTPUT_SA 1u
+#define SA_OUTPUT_ISA 2u
+#define SA_OUTPUT_LCP 4u
+#define SA_OUTPUT_BWT 8u
+
+typedef struct {
+  uint32_t* suffix_array;
+  uint32_t* inverse_suffix_array;
+  uint32_t* lcp;
+  unsigned char* bwt;
+  uint64_t primary;
+  uint32_t allocated;  // outputs whose buffers the library allocated
+} sa_result;
+
+// Arrays of text[0, n) for the requested outputs. Buffers given in result
+// must hold n entries, or n + 1 for the BWT. Texts must be shorter than
+// 2^31 characters. Returns -1 on failure, with the buffers allocated by
+// this call released, 0 otherwise.
+int32_t sa_build(const unsigned char* text, uint64_t n, sa_engine engine,
+                 uint32_t outputs, sa_result* result);
+
+// Block of the distributed text [offset, offset + size) that process rank
+// of p holds for sa_build_distributed.
+void sa_block_range(uint64_t n, int p, int rank, uint64_t* offset,
+                    uint64_t* size);
+
+// Arrays of a text of n characters spread over comm, built with DC3.
+// Collective. Each process passes the block sa_block_range gives it
+// followed by the next two characters of the text, where there are any.
+// Its suffix array and inverse suffix array entries are those of indices
+// [offset, offset + size). Its BWT rows are those of suffix array indices
+// [offset, offset + size), with row 0 first on process 0, so buffers there
+// hold size + 1 bytes. Every process receives primary. Every block must
+// hold at least 3 characters, and LCP is not available here. Texts must be
+// shorter than 2^32 - 1 characters and not contain zero bytes. Returns -1 on
+// every process if any failed.
+int32_t sa_build_distributed(const unsigned char* block, uint64_t size,
+                             uint64_t offset, uint64_t n, MPI_Comm comm,
+                             uint32_t outputs, sa_result* result);
+
+// Frees the buffers the library allocated and clears their pointers.
+void sa_result_free(sa_result* result);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif
@@ -0,0 +1,107 @@
+#include "batch_sa.h"
+
+#include <limits.h>
+#include <algorithm>
+#include <vector>
+#include "../sais/sais.h"
+#include "../simd/mismatch.h"
+
+// Orders the suffixes of data[0, size); a proper prefix comes first.
+struct compare_suffix {
+  compare_suffix(const unsigned char* data, uint32_t size)
+      : _data(data), _size(size) {}
+  bool operator()(uint32_t lhs, uint32_t rhs) const {
+    const uint32_t length = _size - std::max(lhs, rhs);
+    const size_t i = mismatch_bytes(_data + lhs, _data + rhs, length);
+    if (i < length) {
+      return _data[lhs + i] < _data[rhs + i];
+    }
+    return lhs > rhs;
+  }
+  const unsigned char* _data;
+  const uint32_t _size;
+};
+
+static inline uint32_t log2_floor(uint64_t x) {
+  return 63 - __builtin_clzll(x);
+}
+
+int32_t text_suffix_array(const unsigned char* data, uint32_t size,
+                          uint32_t* suffix_array) {
+  if (size > INT_MAX) {
+    return -1;
+  }
+  if (size > BATCH_SORT_MAX) {
+    return sais(data, reinterpret_cast<int*>(suffix_array),
+                static_cast<int>(size)) == 0 ? 0 : -1;
+  }
+  compare_suffix less(data, size);
+  for (uint32_t i = 0; i < size; i++) {
+    suffix_array[i] = i;
+  }
+  if (size > BATCH_INSERTION_MAX) {
+    std::sort(suffix_array, suffix_array + size, less);
+    return 0;
+  }
+  for (uint32_t i = 1; i < size; i++) {
+    const uint32_t suffix = suffix_array[i];
+    uint32_t j = i;
+    for (; j > 0 && less(suffix, suffix_array[j - 1]); j--) {
+      suffix_array[j] = suffix_array[j - 1];
+    }
+    suffix_array[j] = suffix;
+  }
+  return 0;
+}
+
+int32_t batch_suffix_arrays(const unsigned char* data, const uint64_t* offsets,
+                            uint64_t count, uint32_t* suffix_arrays) {
+  // Texts by decreasing size class, floor(log2(size + 1)).
+  const uint32_t CLASSES = 64;
+  std::vector<uint64_t> starts(CLASSES + 1, 0);
+  for (uint64_t i = 0; i < count; i++) {
+    const uint64_t size = offsets[i + 1] - offsets[i];
+    if (size > INT_MAX) {
+      return -1;
+    }
+    starts[CLASSES - log2_floor(size + 1)]++;
+  }
+  for (uint32_t c = 0; c < CLASSES; c++) {
+    starts[c + 1] += starts[c];
+  }
+  std::vector<uint64_t> order(count);
+  for (uint64_t i = 0; i < count; i++) {
+    const uint64_t size = offsets[i + 1] - offsets[i];
+    order[starts[CLASSES - 1 - log2_floor(size + 1)]++] = i;
+  }
+
+  // Tasks are runs of order[] of about BATCH_TASK_SIZE characters; a large
+  // text is a task of its own.
+  std::vector<uint64_t> tasks(1, 0);
+  uint64_t pending = 0;
+  for (uint64_t k = 0; k < count; k++) {
+    pending += offsets[order[k] + 1] - offsets[order[k]] + 1;
+    if (pending >= BATCH_TASK_SIZE) {
+      tasks.push_back(k + 1);
+      pending = 0;
+    }
+  }
+  if (tasks.back() != count) {
+    tasks.push_back(count);
+  }
+
+  int32_t status = 0;
+  const int64_t num_tasks = tasks.size() - 1;
+#pragma omp parallel for schedule(dynamic, 1) reduction(min : status)
+  for (int64_t t = 0; t < num_tasks; t++) {
+    for (uint64_t k = tasks[t]; k < tasks[t + 1]; k++) {
+      const uint64_t i = order[k];
+      if (text_suffix_array(data + offsets[i],
+                            static_cast<uint32_t>(offsets[i + 1] - offsets[i]),
+                            suffix_arrays + offsets[i]) < 0) {
+        status = -1;
+      }
+    }
+  }
+  return status;
+}
@@ -0,0 +1,32 @@
+#ifndef __BATCH_SUFFIX_ARRAY__
+#define __BATCH_SUFFIX_ARRAY__
+
+#include <stdint.h>
+
+/*
+ * Suffix arrays of many independent texts, built concurrently with one task
+ * per text. The texts lie end to end: text i is data[offsets[i],
+ * offsets[i + 1]) and its suffix array, as positions within the text, goes
+ * to the same range of suffix_arrays.
+ *
+ * Texts are handed out largest first, so a long one does not start last and
+ * hold up the batch, and runs of short ones are grouped into tasks of about
+ * BATCH_TASK_SIZE characters so the scheduling cost stays below the work.
+ * Up to BATCH_INSERTION_MAX characters a text is sorted by insertion, up to
+ * BATCH_SORT_MAX by comparison sort, and above that with SA-IS. The short
+ * paths work in the output and allocate nothing.
+ */
+const uint32_t BATCH_INSERTION_MAX = 16;
+const uint32_t BATCH_SORT_MAX = 64;
+const uint64_t BATCH_TASK_SIZE = 1 << 16;
+
+// Texts must be shorter than 2^31 characters. Returns -1 if one is not or if
+// SA-IS fails, 0 otherwise.
+int32_t batch_suffix_arrays(const unsigned char* data, const uint64_t* offsets,
+                            uint64_t count, uint32_t* suffix_arrays);
+
+// One text on the calling thread, by the same rules.
+int32_t text_suffix_array(const unsigned char* data, uint32_t size,
+                          uint32_t* suffix_array);
+
+#endif
@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "../search/index.h"
+#include "batch_sa.h"
+
+using namespace std;
+
+static double wall_time() {
+#ifdef _OPENMP
+  return omp_get_wtime();
+#else
+  return 0;
+#endif
+}
+
+// One document per line, or per NUL-terminated record with -z. The output
+// holds each document's suffix array as raw 32-bit positions within the
+// document, one after the other in input order.
+int main(int argc, char* argv[]) {
+  char separator = '\n';
+  if (argc == 4 && string(argv[1]) == "-z") {
+    separator = '\0';
+    argv++;
+    argc--;
+  }
+  if (argc != 3) {
+    fprintf(stderr, "Usage: %s [-z] <documents> <output>\n", argv[0]);
+    return 1;
+  }
+  uint64_t size = 0;
+  char* data = read_whole_file(argv[1], size);
+  if (data == NULL) {
+    fprintf(stderr, "Failed to read %s\n", argv[1]);
+    return 1;
+  }
+
+  // Documents are packed end to end without their separators.
+  vector<uint64_t> offsets(1, 0);
+  uint64_t packed = 0, start = 0;
+  for (uint64_t i = 0; i <= size; i++) {
+    if (i == size || data[i] == separator) {
+      if (i > start || i < size) {
+        memmove(data + packed, data + start, i - start);
+        packed += i - start;
+        offsets.push_back(packed);
+      }
+      start = i + 1;
+    }
+  }
+  const uint64_t count = offsets.size() - 1;
+
+  uint32_t* suffix_arrays = new (std::nothrow) uint32_t[packed + 1];
+  if (suffix_arrays == NULL) {
+    fprintf(stderr, "Bad alloc \n");
+    delete[] data;
+    return 1;
+  }
+  double elapsed = wall_time();
+  if (batch_suffix_arrays(reinterpret_cast<unsigned char*>(data), &offsets[0],
+                          count, suffix_arrays) < 0) {
+    fprintf(stderr, "Building the suffix arrays failed\n");
+    delete[] data;
+    delete[] suffix_arrays;
+    return 1;
+  }
+  elapsed = wall_time() - elapsed;
+  delete[] data;
+  fprintf(stdout, "Built %lu suffix arrays of %lu characters in %f s", count,
+          packed, elapsed);
+  if (elapsed > 0) {
+    fprintf(stdout, " (%.0f documents/s)", count / elapsed);
+  }
+  fprintf(stdout, "\n");
+
+  FILE* f = fopen(argv[2], "wb");
+  if (f == NULL ||
+      fwrite(suffix_arrays, sizeof(uint32_t), packed, f) != packed) {
+    fprintf(stderr, "Failed to write %s\n", argv[2]);
+    if (f != NULL) fclose(f);
+    delete[] suffix_arrays;
+    return 1;
+  }
+  delete[] suffix_arrays;
+  return fclose(f) == 0 ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+#include "approximate_search.h"
+
+#include <algorithm>
+
+namespace {
+
+void add_search(std::vector<search>& scheme, const uint32_t* order,
+                const uint32_t* lower, const uint32_t* upper,
+                uint32_t parts) {
+  search s;
+  s.order.assign(order, order + parts);
+  s.lower.assign(lower, lower + parts);
+  s.upper.assign(upper, upper + parts);
+  scheme.push_back(s);
+}
+
+}  // namespace
+
+void search_scheme(uint32_t k, error_model model, uint32_t& parts,
+                   std::vector<search>& scheme) {
+  scheme.clear();
+  if (model == MISMATCHES && k == 1) {
+    const uint32_t orders[2][2] = {{0, 1}, {1, 0}};
+    const uint32_t lower[2][2] = {{0, 0}, {0, 1}};
+    const uint32_t upper[2][2] = {{0, 1}, {0, 1}};
+    parts = 2;
+    for (uint32_t i = 0; i < 2; i++) {
+      add_search(scheme, orders[i], lower[i], upper[i], parts);
+    }
+  } else if (model == MISMATCHES && k == 2) {
+    const uint32_t orders[3][3] = {{0, 1, 2}, {2, 1, 0}, {1, 0, 2}};
+    const uint32_t lower[3][3] = {{0, 0, 0}, {0, 0, 0}, {0, 1, 1}};
+    const uint32_t upper[3][3] = {{0, 2, 2}, {0, 1, 2}, {0, 1, 2}};
+    parts = 3;
+    for (uint32_t i = 0; i < 3; i++) {
+      add_search(scheme, orders[i], lower[i], upper[i], parts);
+    }
+  } else if (model == MISMATCHES && k == 3) {
+    const uint32_t orders[4][4] = {
+        {0, 1, 2, 3}, {1, 0, 2, 3}, {2, 3, 1, 0}, {3, 2, 1, 0}};
+    const uint32_t lower[4] = {0, 0, 0, 0};
+    const uint32_t upper[4] = {0, 1, 3, 3};
+    parts = 4;
+    for (uint32_t i = 0; i < 4; i++) {
+      add_search(scheme, orders[i], lower, upper, parts);
+    }
+  } else {
+    // Pigeonhole: part j exact, then the parts right of it, then those
+    // left of it.
+    parts = k + 1;
+    std::vector<uint32_t> order, lower(parts, 0), upper(parts, k);
+    upper[0] = 0;
+    for (uint32_t j = 0; j < parts; j++) {
+      order.clear();
+      for (uint32_t i = j; i < parts; i++) order.push_back(i);
+      for (uint32_t i = j; i > 0; i--) order.push_back(i - 1);
+      add_search(scheme, order.data(), lower.data(), upper.data(), parts);
+    }
+  }
+}
+
+ApproximateSearch::ApproximateSearch(const BidirectionalIndex& index,
+                                     uint32_t k, error_model model)
+    : index_(index), k_(k), model_(model) {
+  search_scheme(k_, model_, parts_, scheme_);
+}
+
+// Matches the rest of part order[s], then the parts after it. [lo, hi) is
+// the part of the pattern matched so far.
+void ApproximateSearch::match(const query& q, uint32_t s,
+                              const bi_interval& interval, uint32_t lo,
+                              uint32_t hi, uint32_t errors, step last) const {
+  const search& current = *q.current;
+  const uint32_t part = current.order[s];
+  const uint32_t begin = q.bounds[part];
+  const uint32_t end = q.bounds[part + 1];
+  if (lo <= begin && hi >= end) {
+    if (errors < current.lower[s]) {
+      return;
+    }
+    if (s + 1 < current.order.size()) {
+      match(q, s + 1, interval, lo, hi, errors, last);
+    } else {
+      report(q, interval, errors);
+    }
+    return;
+  }
+
+  const bool right = hi < end;
+  const uint32_t i = right ? hi : lo - 1;
+  const uint32_t next_lo = right ? lo : lo - 1;
+  const uint32_t next_hi = right ? hi + 1 : hi;
+  const uint32_t upper = current.upper[s];
+  const std::vector<unsigned char>& alphabet = index_.alphabet();
+  bi_interval next;
+  for (size_t a = 0; a < alphabet.size(); a++) {
+    const unsigned char c = alphabet[a];
+    const uint32_t cost = c == q.pattern[i] ? 0 : 1;
+    if (errors + cost > upper) {
+      continue;
+    }
+    if (!(right ? index_.extend_right(interval, c, next)
+                : index_.extend_left(interval, c, next))) {
+      continue;
+    }
+    match(q, s, next, next_lo, next_hi, errors + cost, ALIGNED);
+    // c left out of the pattern, only between matched positions. Next to
+    // an insertion it would just be a dearer substitution, which the
+    // schemes for edits always allow as well.
+    if (model_ == EDITS && errors < upper && lo < hi && last != INSERTED) {
+      match(q, s, next, lo, hi, errors + 1, DELETED);
+    }
+  }
+  // pattern character i left out of the text
+  if (model_ == EDITS && errors < upper && last != DELETED) {
+    match(q, s, interval, next_lo, next_hi, errors + 1, INSERTED);
+  }
+}
+
+// Text characters left out before the pattern's first move the start, so
+// they give occurrences of their own.
+void ApproximateSearch::report(const query& q, const bi_interval& interval,
+                               uint32_t errors) const {
+  q.rows->push_back(
+      std::make_pair(interval.forward, interval.forward + interval.length));
+  if (model_ != EDITS || errors >= k_) {
+    return;
+  }
+  const std::vector<unsigned char>& alphabet = index_.alphabet();
+  bi_interval next;
+  for (size_t a = 0; a < alphabet.size(); a++) {
+    if (index_.extend_left(interval, alphabet[a], next)) {
+      report(q, next, errors + 1);
+    }
+  }
+}
+
+void ApproximateSearch::find(
+    const unsigned char* pattern, uint32_t length,
+    std::vector<std::pair<uint64_t, uint64_t> >& rows) const {
+  std::vector<std::pair<uint64_t, uint64_t> > found;
+  query q;
+  q.pattern = pattern;
+  q.rows = &found;
+
+  // Patterns too short to cut fall back to one part and plain
+  // backtracking.
+  std::vector<search> single;
+  const std::vector<search>* scheme = &scheme_;
+  uint32_t parts = parts_;
+  if (length < parts_) {
+    search s;
+    s.order.assign(1, 0);
+    s.lower.assign(1, 0);
+    s.upper.assign(1, k_);
+    single.push_back(s);
+    scheme = &single;
+    parts = 1;
+  }
+  for (uint32_t j = 0; j <= parts; j++) {
+    q.bounds.push_back(static_cast<uint64_t>(length) * j / parts);
+  }
+  for (size_t i = 0; i < scheme->size(); i++) {
+    q.current = &(*scheme)[i];
+    const uint32_t start = q.bounds[q.current->order[0]];
+    match(q, 0, index_.all(), start, start, 0, ALIGNED);
+  }
+
+  // Searches overlap, and row 0 is the empty suffix, not a position.
+  std::sort(found.begin(), found.end());
+  rows.clear();
+  for (size_t i = 0; i < found.size(); i++) {
+    const uint64_t first = std::max<uint64_t>(found[i].first, 1);
+    if (first >= found[i].second) {
+      continue;
+    }
+    if (!rows.empty() && first <= rows.back().second) {
+      rows.back().second = std::max(rows.back().second, found[i].second);
+    } else {
+      rows.push_back(std::make_pair(first, found[i].second));
+    }
+  }
+}
+
+uint64_t ApproximateSearch::count(const unsigned char* pattern,
+                                  uint32_t length) const {
+  std::vector<std::pair<uint64_t, uint64_t> > rows;
+  find(pattern, length, rows);
+  uint64_t total = 0;
+  for (size_t i = 0; i < rows.size(); i++) {
+    total += rows[i].second - rows[i].first;
+  }
+  return total;
+}
@@ -0,0 +1,78 @@
+#ifndef __APPROXIMATE_SEARCH__
+#define __APPROXIMATE_SEARCH__
+
+#include <stdint.h>
+#include <utility>
+#include <vector>
+#include "bidir_index.h"
+
+enum error_model { MISMATCHES, EDITS };
+
+// One search of a search scheme: the pattern parts in the order they are
+// matched, and the least and most errors allowed once each is matched.
+struct search {
+  std::vector<uint32_t> order;
+  std::vector<uint32_t> lower;
+  std::vector<uint32_t> upper;
+};
+
+// Search scheme for up to k errors; parts is the number of pieces the
+// pattern is cut into.
+void search_scheme(uint32_t k, error_model model, uint32_t& parts,
+                   std::vector<search>& scheme);
+
+/*
+ * Approximate matching over a BidirectionalIndex with search schemes
+ * (Kucherov, Salikhov and Tsur, Approximate string matching using a
+ * bidirectional index, 2016). The pattern is cut into parts and every
+ * search of the scheme matches them in its own order, growing the match
+ * left or right and backtracking over the characters of the text, with the
+ * errors bounded after each part. Every distribution of up to k errors over
+ * the parts is allowed by some search, so no occurrence is missed, and the
+ * tight first bounds keep the backtracking narrow.
+ *
+ * Mismatches use the schemes of the paper for k <= 3. Edits, and
+ * mismatches for larger k, use the pigeonhole scheme: k + 1 parts, one of
+ * which matches exactly, each tried first in turn. A text character left
+ * out of the pattern is only taken between two matched positions, so it
+ * counts against the part matched later and the exact part stays exact.
+ *
+ * An occurrence is a text position where a substring within k errors of
+ * the pattern starts.
+ */
+class ApproximateSearch {
+ public:
+  ApproximateSearch(const BidirectionalIndex& index, uint32_t k,
+                    error_model model);
+
+  // Forward BWT rows [first, second) of the occurrences, sorted and
+  // disjoint.
+  void find(const unsigned char* pattern, uint32_t length,
+            std::vector<std::pair<uint64_t, uint64_t> >& rows) const;
+
+  uint64_t count(const unsigned char* pattern, uint32_t length) const;
+
+ private:
+  struct query {
+    const unsigned char* pattern;
+    std::vector<uint32_t> bounds;  // part j is [bounds[j], bounds[j + 1])
+    const search* current;
+    std::vector<std::pair<uint64_t, uint64_t> >* rows;
+  };
+
+  // Last step taken, for edits.
+  enum step { ALIGNED, INSERTED, DELETED };
+
+  void match(const query& q, uint32_t s, const bi_interval& interval,
+             uint32_t lo, uint32_t hi, uint32_t errors, step last) const;
+  void report(const query& q, const bi_interval& interval,
+              uint32_t errors) const;
+
+  const BidirectionalIndex& index_;
+  uint32_t k_;
+  error_model model_;
+  uint32_t parts_;
+  std::vector<search> scheme_;
+};
+
+#endif
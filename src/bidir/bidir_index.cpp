@@ -0,0 +1,144 @@
+#include "bidir_index.h"
+
+#include <stdio.h>
+#include <algorithm>
+
+int32_t BidirectionalIndex::side::load(const char* filename,
+                                       uint64_t& size) {
+  FILE* f = fopen(filename, "rb");
+  if (f == NULL) {
+    return -1;
+  }
+  uint64_t header[2];
+  if (fread(header, sizeof(uint64_t), 2, f) != 2 || header[1] > header[0]) {
+    fclose(f);
+    return -1;
+  }
+  size = header[0];
+  primary = header[1];
+  rows.resize(size + 1);
+  const bool ok = fread(rows.data(), 1, size + 1, f) == size + 1;
+  fclose(f);
+  if (!ok) {
+    return -1;
+  }
+
+  const uint64_t samples = size / BIDIR_SAMPLE + 2;
+  smaller.assign(samples * 257, 0);
+  uint32_t counts[256] = {0};
+  for (uint64_t s = 0; s < samples; s++) {
+    uint32_t* sample = &smaller[s * 257];
+    for (uint32_t c = 0; c < 256; c++) {
+      sample[c + 1] = sample[c] + counts[c];
+    }
+    const uint64_t end = std::min((s + 1) * BIDIR_SAMPLE, size + 1);
+    for (uint64_t i = s * BIDIR_SAMPLE; i < end; i++) {
+      if (i != primary) {
+        counts[rows[i]]++;
+      }
+    }
+  }
+  return 0;
+}
+
+// Rows in [0, row) holding a character below c, for c up to 256.
+uint64_t BidirectionalIndex::side::count_smaller(uint32_t c,
+                                                 uint64_t row) const {
+  const uint64_t s = row / BIDIR_SAMPLE;
+  uint64_t result = smaller[s * 257 + c];
+  for (uint64_t i = s * BIDIR_SAMPLE; i < row; i++) {
+    if (rows[i] < c && i != primary) {
+      result++;
+    }
+  }
+  return result;
+}
+
+// Rows in [0, row) holding a character below c and holding c.
+void BidirectionalIndex::side::count(unsigned char c, uint64_t row,
+                                     uint64_t& below, uint64_t& equal) const {
+  const uint64_t s = row / BIDIR_SAMPLE;
+  below = smaller[s * 257 + c];
+  equal = smaller[s * 257 + c + 1] - below;
+  for (uint64_t i = s * BIDIR_SAMPLE; i < row; i++) {
+    if (i != primary) {
+      below += rows[i] < c;
+      equal += rows[i] == c;
+    }
+  }
+}
+
+int32_t BidirectionalIndex::load(const char* forward_bwt,
+                                 const char* reverse_bwt) {
+  uint64_t reverse_size = 0;
+  if (forward_.load(forward_bwt, size_) < 0 ||
+      reverse_.load(reverse_bwt, reverse_size) < 0 ||
+      reverse_size != size_) {
+    return -1;
+  }
+  for (uint32_t c = 0; c <= 256; c++) {
+    first_row_[c] = 1 + forward_.count_smaller(c, size_ + 1);
+  }
+  alphabet_.clear();
+  for (uint32_t c = 0; c < 256; c++) {
+    if (first_row_[c + 1] > first_row_[c]) {
+      alphabet_.push_back(static_cast<unsigned char>(c));
+    }
+  }
+  return 0;
+}
+
+// Extends on the side whose BWT is bwt: from and length are the interval
+// there, other its start in the opposite BWT.
+bool BidirectionalIndex::extend(const side& bwt, const uint64_t* first_row,
+                                uint64_t from, uint64_t other,
+                                uint64_t length, unsigned char c,
+                                uint64_t& new_from, uint64_t& new_other,
+                                uint64_t& new_length) {
+  const uint64_t to = from + length;
+  uint64_t below_begin, rank_begin, below_end, rank_end;
+  bwt.count(c, from, below_begin, rank_begin);
+  bwt.count(c, to, below_end, rank_end);
+  if (rank_end == rank_begin) {
+    return false;
+  }
+  // $ sorts before every character.
+  const uint64_t dollar = bwt.primary >= from && bwt.primary < to ? 1 : 0;
+  new_from = first_row[c] + rank_begin;
+  new_other = other + dollar + below_end - below_begin;
+  new_length = rank_end - rank_begin;
+  return true;
+}
+
+bool BidirectionalIndex::extend_left(const bi_interval& in, unsigned char c,
+                                     bi_interval& out) const {
+  return extend(forward_, first_row_, in.forward, in.reverse, in.length, c,
+                out.forward, out.reverse, out.length);
+}
+
+bool BidirectionalIndex::extend_right(const bi_interval& in,
+                                      unsigned char c,
+                                      bi_interval& out) const {
+  return extend(reverse_, first_row_, in.reverse, in.forward, in.length, c,
+                out.reverse, out.forward, out.length);
+}
+
+uint64_t BidirectionalIndex::count(const unsigned char* pattern,
+                                   uint32_t length) const {
+  if (length == 0) {
+    return size_;
+  }
+  bi_interval interval = all();
+  const uint32_t middle = length / 2;
+  for (uint32_t i = middle; i < length; i++) {
+    if (!extend_right(interval, pattern[i], interval)) {
+      return 0;
+    }
+  }
+  for (uint32_t i = middle; i > 0; i--) {
+    if (!extend_left(interval, pattern[i - 1], interval)) {
+      return 0;
+    }
+  }
+  return interval.length;
+}
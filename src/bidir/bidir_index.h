@@ -0,0 +1,87 @@
+#ifndef __BIDIR_INDEX__
+#define __BIDIR_INDEX__
+
+#include <stdint.h>
+#include <vector>
+
+// Rows per occurrence sample.
+const uint64_t BIDIR_SAMPLE = 256;
+
+// A pattern's rows in both BWTs: [forward, forward + length) among the
+// suffixes of the text, [reverse, reverse + length) among those of the
+// reversed text for the reversed pattern.
+struct bi_interval {
+  uint64_t forward;
+  uint64_t reverse;
+  uint64_t length;
+};
+
+/*
+ * Bidirectional FM-index over the two BWT files written by the DC3 builder
+ * with -b. Extending a pattern on the left is backward search on the
+ * forward BWT; the reversed pattern's interval in the reverse BWT moves by
+ * the rows whose preceding character is smaller than the new one, since
+ * those are the rows of the reversed text that follow it with a smaller
+ * character. Extending on the right is the same with the roles swapped, so
+ * a search can grow a pattern in either direction in any order.
+ *
+ * Each BWT keeps, every BIDIR_SAMPLE rows, the number of rows before it
+ * holding a character smaller than c for every c, so one scan of at most
+ * BIDIR_SAMPLE rows gives both the rank of c and the count of smaller
+ * characters.
+ */
+class BidirectionalIndex {
+ public:
+  BidirectionalIndex() : size_(0) {}
+
+  int32_t load(const char* forward_bwt, const char* reverse_bwt);
+
+  uint64_t size() const { return size_; }
+
+  // Characters occurring in the text, in order.
+  const std::vector<unsigned char>& alphabet() const { return alphabet_; }
+
+  // Interval of the empty pattern: all rows of both.
+  bi_interval all() const {
+    bi_interval all = {0, 0, size_ + 1};
+    return all;
+  }
+
+  // Interval of c followed by the pattern of in; false if it is empty.
+  bool extend_left(const bi_interval& in, unsigned char c,
+                   bi_interval& out) const;
+  // Interval of the pattern of in followed by c; false if it is empty.
+  bool extend_right(const bi_interval& in, unsigned char c,
+                    bi_interval& out) const;
+
+  // Occurrences of the pattern, grown from its middle outwards.
+  uint64_t count(const unsigned char* pattern, uint32_t length) const;
+
+ private:
+  struct side {
+    std::vector<unsigned char> rows;
+    uint64_t primary;  // the row holding $
+    // smaller[s * 257 + c]: rows before s * BIDIR_SAMPLE holding a
+    // character below c, $ not counted
+    std::vector<uint32_t> smaller;
+
+    int32_t load(const char* filename, uint64_t& size);
+    uint64_t count_smaller(uint32_t c, uint64_t row) const;
+    void count(unsigned char c, uint64_t row, uint64_t& below,
+               uint64_t& equal) const;
+  };
+
+  static bool extend(const side& bwt, const uint64_t* first_row,
+                     uint64_t from, uint64_t other, uint64_t length,
+                     unsigned char c, uint64_t& new_from,
+                     uint64_t& new_other, uint64_t& new_length);
+
+  uint64_t size_;
+  std::vector<unsigned char> alphabet_;
+  side forward_;
+  side reverse_;
+  // first row of each character; the same in both directions
+  uint64_t first_row_[257];
+};
+
+#endif
@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include "../search/index.h"
+#include "approximate_search.h"
+#include "bidir_index.h"
+
+using namespace std;
+
+// One pattern per line; each output line is the line number and the count.
+// With -m or -e the count is of positions starting a substring within k
+// mismatches or edits of the pattern.
+int main(int argc, char* argv[]) {
+  const char* usage =
+      "Usage: %s [-m <k> | -e <k>] <bwt> <reverse bwt> <patterns> <output>\n";
+  uint32_t k = 0;
+  error_model model = MISMATCHES;
+  bool approximate = false;
+  if (argc == 7 && (string(argv[1]) == "-m" || string(argv[1]) == "-e")) {
+    model = string(argv[1]) == "-m" ? MISMATCHES : EDITS;
+    k = atoi(argv[2]);
+    approximate = true;
+    argv += 2;
+    argc -= 2;
+  }
+  if (argc != 5) {
+    fprintf(stderr, usage, argv[0]);
+    return 1;
+  }
+  BidirectionalIndex index;
+  if (index.load(argv[1], argv[2]) < 0) {
+    fprintf(stderr, "Failed to load %s and %s\n", argv[1], argv[2]);
+    return 1;
+  }
+  fprintf(stdout, "Loaded %lu characters\n", index.size());
+
+  vector<string> patterns;
+  if (read_lines(argv[3], patterns) < 0) {
+    fprintf(stderr, "Failed to read %s\n", argv[3]);
+    return 1;
+  }
+
+  // Backtracking cost varies a lot between patterns, so approximate
+  // queries are handed out one at a time.
+  vector<uint64_t> counts(patterns.size());
+  if (approximate) {
+    ApproximateSearch search(index, k, model);
+#pragma omp parallel for schedule(dynamic, 1)
+    for (size_t q = 0; q < patterns.size(); q++) {
+      counts[q] = search.count(
+          reinterpret_cast<const unsigned char*>(patterns[q].data()),
+          patterns[q].size());
+    }
+  } else {
+#pragma omp parallel for schedule(dynamic, 16)
+    for (size_t q = 0; q < patterns.size(); q++) {
+      counts[q] = index.count(
+          reinterpret_cast<const unsigned char*>(patterns[q].data()),
+          patterns[q].size());
+    }
+  }
+
+  FILE* f = fopen(argv[4], "w");
+  if (f == NULL) {
+    fprintf(stderr, "Failed to write %s\n", argv[4]);
+    return 1;
+  }
+  for (size_t q = 0; q < counts.size(); q++) {
+    fprintf(f, "%zu\t%lu\n", q, counts[q]);
+  }
+  return fclose(f) == 0 ? 0 : 1;
+}
@@ -0,0 +1,158 @@
+#include "block_sort.h"
+
+#include <limits.h>
+#include <algorithm>
+#include <new>
+#include "../sais/sais.h"
+
+// Rows of the LF table counted by one thread in the inverse transform.
+const uint64_t LF_CHUNK = 1 << 16;
+const uint64_t MAX_LF_CHUNKS = 1024;
+
+uint32_t bwt_num_samples(uint32_t size, uint32_t sample_step) {
+  if (size == 0) {
+    return 0;
+  }
+  return (size - 1) / sample_step;
+}
+
+int32_t bwt_forward(const unsigned char* data, uint32_t size,
+                    unsigned char* bwt, uint32_t* primary_index,
+                    uint32_t sample_step, uint32_t* samples) {
+  *primary_index = 0;
+  if (size == 0) {
+    return 0;
+  }
+  if (size > INT_MAX || sample_step == 0) {
+    return -1;
+  }
+
+  int* SA = new (std::nothrow) int[size];
+  if (SA == NULL) {
+    return -1;
+  }
+  if (sais(data, SA, static_cast<int>(size)) != 0) {
+    delete[] SA;
+    return -1;
+  }
+
+  // Row i + 1 holds suffix SA[i]; the suffix starting at 0 is preceded by '$'.
+  int64_t pidx = 0;
+#pragma omp parallel for schedule(static)
+  for (int64_t i = 0; i < static_cast<int64_t>(size); i++) {
+    if (SA[i] == 0) {
+      pidx = i + 1;
+    }
+  }
+
+  bwt[0] = data[size - 1];
+#pragma omp parallel for schedule(static)
+  for (int64_t i = 0; i < static_cast<int64_t>(size); i++) {
+    const uint32_t pos = static_cast<uint32_t>(SA[i]);
+    if (pos == 0) {
+      continue;
+    }
+    const int64_t row = i + 1;
+    bwt[row - (row > pidx)] = data[pos - 1];
+    if (pos % sample_step == 0) {
+      samples[pos / sample_step - 1] = static_cast<uint32_t>(row);
+    }
+  }
+
+  delete[] SA;
+  *primary_index = static_cast<uint32_t>(pidx);
+  return 0;
+}
+
+int32_t bwt_inverse(const unsigned char* bwt, uint32_t size,
+                    uint32_t primary_index, uint32_t sample_step,
+                    const uint32_t* samples, unsigned char* data) {
+  if (size == 0) {
+    return 0;
+  }
+  if (primary_index == 0 || primary_index > size || sample_step == 0) {
+    return -1;
+  }
+
+  const int64_t rows = static_cast<int64_t>(size) + 1;
+  const int64_t pidx = primary_index;
+  const uint32_t num_samples = bwt_num_samples(size, sample_step);
+  for (uint32_t i = 0; i < num_samples; i++) {
+    if (samples[i] >= rows || samples[i] == pidx) {
+      return -1;
+    }
+  }
+
+  uint32_t* LF = new (std::nothrow) uint32_t[rows];
+  int64_t num_chunks = (rows + LF_CHUNK - 1) / LF_CHUNK;
+  if (num_chunks > static_cast<int64_t>(MAX_LF_CHUNKS)) {
+    num_chunks = MAX_LF_CHUNKS;
+  }
+  const int64_t chunk_rows = (rows + num_chunks - 1) / num_chunks;
+  uint64_t* counts = new (std::nothrow) uint64_t[num_chunks * 256]();
+  if (LF == NULL || counts == NULL) {
+    delete[] LF;
+    delete[] counts;
+    return -1;
+  }
+
+  // Count characters per chunk of rows.
+#pragma omp parallel for schedule(static)
+  for (int64_t chunk = 0; chunk < num_chunks; chunk++) {
+    uint64_t* local = counts + chunk * 256;
+    const int64_t end = std::min(rows, (chunk + 1) * chunk_rows);
+    for (int64_t r = chunk * chunk_rows; r < end; r++) {
+      if (r != pidx) {
+        local[bwt[r - (r > pidx)]]++;
+      }
+    }
+  }
+
+  // Turn the counts into the first LF target of every (chunk, character).
+  // Target row 0 is the '$' rotation, so the first character starts at 1.
+  uint64_t next = 1;
+  for (uint32_t c = 0; c < 256; c++) {
+    for (int64_t chunk = 0; chunk < num_chunks; chunk++) {
+      const uint64_t count = counts[chunk * 256 + c];
+      counts[chunk * 256 + c] = next;
+      next += count;
+    }
+  }
+
+#pragma omp parallel for schedule(static)
+  for (int64_t chunk = 0; chunk < num_chunks; chunk++) {
+    uint64_t* local = counts + chunk * 256;
+    const int64_t end = std::min(rows, (chunk + 1) * chunk_rows);
+    for (int64_t r = chunk * chunk_rows; r < end; r++) {
+      if (r == pidx) {
+        LF[r] = 0;
+      } else {
+        LF[r] = static_cast<uint32_t>(local[bwt[r - (r > pidx)]]++);
+      }
+    }
+  }
+  delete[] counts;
+
+  // Decode every sampled stretch of text with its own walk. The stretch
+  // ending at the end of the block starts from the '$' row.
+  const int64_t num_walks = num_samples + 1;
+  int32_t status = 0;
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int64_t k = 0; k < num_walks; k++) {
+    const uint64_t begin = k * static_cast<uint64_t>(sample_step);
+    const uint64_t end = std::min(static_cast<uint64_t>(size),
+                                  begin + sample_step);
+    int64_t r = (end == size) ? 0 : samples[k];
+    for (uint64_t p = end; p > begin; p--) {
+      if (r == pidx) {
+        status = -1;
+        break;
+      }
+      data[p - 1] = bwt[r - (r > pidx)];
+      r = LF[r];
+    }
+  }
+
+  delete[] LF;
+  return status;
+}
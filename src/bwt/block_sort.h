@@ -0,0 +1,30 @@
+#ifndef __BWT_BLOCK_SORT__
+#define __BWT_BLOCK_SORT__
+
+#include <stdint.h>
+
+/*
+ * Burrows-Wheeler transform of a single block.
+ *
+ * Rows of the sorted rotation matrix of data$ are numbered 0..size, row 0
+ * being the rotation that starts with '$'. The '$' itself is not stored: bwt
+ * holds the remaining size characters and primary_index is the row whose last
+ * character would have been '$'.
+ *
+ * samples[j - 1] is the row of text position j * sample_step, for every
+ * 0 < j * sample_step < size. They let the inverse transform start an
+ * independent LF-walk at each sampled position.
+ */
+
+// Number of samples bwt_forward writes for a block of the given size.
+uint32_t bwt_num_samples(uint32_t size, uint32_t sample_step);
+
+int32_t bwt_forward(const unsigned char* data, uint32_t size,
+                    unsigned char* bwt, uint32_t* primary_index,
+                    uint32_t sample_step, uint32_t* samples);
+
+int32_t bwt_inverse(const unsigned char* bwt, uint32_t size,
+                    uint32_t primary_index, uint32_t sample_step,
+                    const uint32_t* samples, unsigned char* data);
+
+#endif
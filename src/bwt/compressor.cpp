@@ -0,0 +1,150 @@
+#include "compressor.h"
+
+#include <string.h>
+#include <algorithm>
+#include <new>
+#include "block_sort.h"
+#include "entropy.h"
+
+template <typename T>
+static void append(std::vector<uint8_t>& out, T value) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+  out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+static bool take(const uint8_t* in, uint64_t in_size, uint64_t& pos,
+                 T& value) {
+  if (in_size < sizeof(T) || pos > in_size - sizeof(T)) {
+    return false;
+  }
+  memcpy(&value, in + pos, sizeof(T));
+  pos += sizeof(T);
+  return true;
+}
+
+int32_t compress_block(const unsigned char* data, uint32_t size,
+                       std::vector<uint8_t>& out) {
+  const uint32_t num_samples = bwt_num_samples(size, BWT_SAMPLE_STEP);
+  unsigned char* bwt = new (std::nothrow) unsigned char[size + 1];
+  uint32_t* samples = new (std::nothrow) uint32_t[num_samples + 1];
+  if (bwt == NULL || samples == NULL) {
+    delete[] bwt;
+    delete[] samples;
+    return -1;
+  }
+
+  uint32_t primary_index = 0;
+  if (bwt_forward(data, size, bwt, &primary_index, BWT_SAMPLE_STEP,
+                  samples) < 0) {
+    delete[] bwt;
+    delete[] samples;
+    return -1;
+  }
+
+  // Segments are coded independently, one per thread.
+  const uint32_t num_segments =
+      (size + BWT_SEGMENT_SIZE - 1) / BWT_SEGMENT_SIZE;
+  std::vector<std::vector<uint8_t> > coded(num_segments);
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int64_t i = 0; i < static_cast<int64_t>(num_segments); i++) {
+    const uint64_t begin = i * static_cast<uint64_t>(BWT_SEGMENT_SIZE);
+    const uint64_t end = std::min(static_cast<uint64_t>(size),
+                                  begin + BWT_SEGMENT_SIZE);
+    entropy_encode(bwt + begin, static_cast<uint32_t>(end - begin), coded[i]);
+  }
+
+  append<uint32_t>(out, size);
+  append<uint32_t>(out, primary_index);
+  append<uint32_t>(out, BWT_SAMPLE_STEP);
+  append<uint32_t>(out, num_samples);
+  for (uint32_t i = 0; i < num_samples; i++) {
+    append<uint32_t>(out, samples[i]);
+  }
+  append<uint32_t>(out, num_segments);
+  append<uint32_t>(out, BWT_SEGMENT_SIZE);
+  for (uint32_t i = 0; i < num_segments; i++) {
+    append<uint64_t>(out, coded[i].size());
+  }
+  for (uint32_t i = 0; i < num_segments; i++) {
+    out.insert(out.end(), coded[i].begin(), coded[i].end());
+  }
+
+  delete[] bwt;
+  delete[] samples;
+  return 0;
+}
+
+int64_t block_raw_size(const uint8_t* in, uint64_t in_size) {
+  uint64_t pos = 0;
+  uint32_t size;
+  if (!take(in, in_size, pos, size)) {
+    return -1;
+  }
+  return size;
+}
+
+int32_t decompress_block(const uint8_t* in, uint64_t in_size,
+                         unsigned char* out, uint32_t size) {
+  uint64_t pos = 0;
+  uint32_t stored_size, primary_index, sample_step, num_samples;
+  if (!take(in, in_size, pos, stored_size) ||
+      !take(in, in_size, pos, primary_index) ||
+      !take(in, in_size, pos, sample_step) ||
+      !take(in, in_size, pos, num_samples)) {
+    return -1;
+  }
+  if (stored_size != size || sample_step == 0 ||
+      num_samples != bwt_num_samples(size, sample_step) ||
+      num_samples > (in_size - pos) / sizeof(uint32_t)) {
+    return -1;
+  }
+  std::vector<uint32_t> samples(num_samples);
+  for (uint32_t i = 0; i < num_samples; i++) {
+    take(in, in_size, pos, samples[i]);
+  }
+
+  uint32_t num_segments, segment_size;
+  if (!take(in, in_size, pos, num_segments) ||
+      !take(in, in_size, pos, segment_size) || segment_size == 0 ||
+      num_segments != (size + segment_size - 1) / segment_size ||
+      num_segments > (in_size - pos) / sizeof(uint64_t)) {
+    return -1;
+  }
+  std::vector<uint64_t> segment_offset(num_segments + 1);
+  for (uint32_t i = 0; i < num_segments; i++) {
+    uint64_t bytes = 0;
+    take(in, in_size, pos, bytes);
+    if (bytes > in_size - pos) {
+      return -1;
+    }
+    segment_offset[i + 1] = segment_offset[i] + bytes;
+  }
+  if (segment_offset[num_segments] > in_size - pos) {
+    return -1;
+  }
+
+  unsigned char* bwt = new (std::nothrow) unsigned char[size + 1];
+  if (bwt == NULL) {
+    return -1;
+  }
+  int32_t status = 0;
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int64_t i = 0; i < static_cast<int64_t>(num_segments); i++) {
+    const uint64_t begin = i * static_cast<uint64_t>(segment_size);
+    const uint64_t end = std::min(static_cast<uint64_t>(size),
+                                  begin + segment_size);
+    if (entropy_decode(in + pos + segment_offset[i],
+                       segment_offset[i + 1] - segment_offset[i], bwt + begin,
+                       static_cast<uint32_t>(end - begin)) < 0) {
+      status = -1;
+    }
+  }
+
+  if (status == 0) {
+    status = bwt_inverse(bwt, size, primary_index, sample_step,
+                         samples.empty() ? NULL : &samples[0], out);
+  }
+  delete[] bwt;
+  return status;
+}
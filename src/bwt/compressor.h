@@ -0,0 +1,29 @@
+#ifndef __BWT_COMPRESSOR__
+#define __BWT_COMPRESSOR__
+
+#include <stdint.h>
+#include <vector>
+
+/*
+ * Block-sorting compression of one block: BWT, then MTF/RLE/Huffman over
+ * fixed-size segments of the transformed block.
+ *
+ * Coded block layout (host byte order):
+ *   u32 size, u32 primary_index, u32 sample_step, u32 num_samples,
+ *   u32 samples[num_samples], u32 num_segments, u32 segment_size,
+ *   u64 segment_bytes[num_segments], segment payloads.
+ */
+
+const uint32_t BWT_SEGMENT_SIZE = 1 << 20;
+const uint32_t BWT_SAMPLE_STEP = 1 << 20;
+
+int32_t compress_block(const unsigned char* data, uint32_t size,
+                       std::vector<uint8_t>& out);
+
+// Uncompressed size of a coded block, or -1 if the header is truncated.
+int64_t block_raw_size(const uint8_t* in, uint64_t in_size);
+
+int32_t decompress_block(const uint8_t* in, uint64_t in_size,
+                         unsigned char* out, uint32_t size);
+
+#endif
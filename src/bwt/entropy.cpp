@@ -0,0 +1,365 @@
+#include "entropy.h"
+
+#include <string.h>
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+// Symbols: RUNA and RUNB are the bijective base-2 digits of a run of zeros,
+// MTF value v > 0 is symbol v + 1 and EOB terminates the segment.
+const uint32_t RUNA = 0;
+const uint32_t RUNB = 1;
+const uint32_t EOB = 257;
+const uint32_t ALPHABET = 258;
+
+const uint32_t MAX_CODE_LEN = 20;
+const uint32_t LENGTH_BITS = 5;
+const uint32_t LOOKUP_BITS = 12;
+
+class BitWriter {
+ public:
+  explicit BitWriter(std::vector<uint8_t>& out) : _out(out), _acc(0), _bits(0) {}
+
+  // Writes the low len bits of value, most significant first. len <= 32.
+  void put(uint32_t value, uint32_t len) {
+    _acc = (_acc << len) | value;
+    _bits += len;
+    while (_bits >= 8) {
+      _bits -= 8;
+      _out.push_back(static_cast<uint8_t>(_acc >> _bits));
+    }
+  }
+
+  void flush() {
+    if (_bits > 0) {
+      _out.push_back(static_cast<uint8_t>(_acc << (8 - _bits)));
+      _bits = 0;
+    }
+  }
+
+ private:
+  std::vector<uint8_t>& _out;
+  uint64_t _acc;
+  uint32_t _bits;
+};
+
+class BitReader {
+ public:
+  BitReader(const uint8_t* in, uint64_t size)
+      : _in(in), _size(size), _pos(0), _acc(0), _bits(0) {}
+
+  // Reads past the end return zero bits; callers check overrun() at the end.
+  uint32_t peek(uint32_t len) {
+    if (_bits < len) {
+      while (_bits <= 56) {
+        _acc = (_acc << 8) | (_pos < _size ? _in[_pos] : 0);
+        _pos++;
+        _bits += 8;
+      }
+    }
+    return static_cast<uint32_t>((_acc >> (_bits - len)) &
+                                 ((static_cast<uint64_t>(1) << len) - 1));
+  }
+
+  void skip(uint32_t len) { _bits -= len; }
+
+  uint32_t get(uint32_t len) {
+    uint32_t value = peek(len);
+    skip(len);
+    return value;
+  }
+
+  bool overrun() const { return _pos * 8 - _bits > _size * 8; }
+
+ private:
+  const uint8_t* _in;
+  const uint64_t _size;
+  uint64_t _pos;
+  uint64_t _acc;
+  uint32_t _bits;
+};
+
+// Huffman code lengths limited to MAX_CODE_LEN. Like bzip2, frequencies are
+// flattened and the tree rebuilt until the longest code fits.
+static void huffman_code_lengths(const uint64_t* freq, uint8_t* lengths) {
+  typedef std::pair<uint64_t, uint32_t> node;
+  std::vector<uint64_t> weight(freq, freq + ALPHABET);
+  std::vector<int32_t> parent(2 * ALPHABET);
+
+  while (true) {
+    std::priority_queue<node, std::vector<node>, std::greater<node> > heap;
+    std::fill(parent.begin(), parent.end(), -1);
+    memset(lengths, 0, ALPHABET);
+    for (uint32_t s = 0; s < ALPHABET; s++) {
+      if (weight[s] > 0) {
+        heap.push(node(weight[s], s));
+      }
+    }
+    if (heap.size() == 1) {
+      lengths[heap.top().second] = 1;
+      return;
+    }
+
+    uint32_t next = ALPHABET;
+    while (heap.size() > 1) {
+      node a = heap.top();
+      heap.pop();
+      node b = heap.top();
+      heap.pop();
+      parent[a.second] = next;
+      parent[b.second] = next;
+      heap.push(node(a.first + b.first, next));
+      next++;
+    }
+
+    uint32_t max_len = 0;
+    for (uint32_t s = 0; s < ALPHABET; s++) {
+      if (weight[s] == 0) {
+        continue;
+      }
+      uint32_t depth = 0;
+      for (int32_t n = s; parent[n] != -1; n = parent[n]) {
+        depth++;
+      }
+      lengths[s] = static_cast<uint8_t>(depth);
+      max_len = std::max(max_len, depth);
+    }
+    if (max_len <= MAX_CODE_LEN) {
+      return;
+    }
+    for (uint32_t s = 0; s < ALPHABET; s++) {
+      if (weight[s] > 0) {
+        weight[s] = 1 + weight[s] / 2;
+      }
+    }
+  }
+}
+
+// Canonical codes: shorter codes first, ties broken by symbol.
+static void canonical_codes(const uint8_t* lengths, uint32_t* codes) {
+  uint32_t count[MAX_CODE_LEN + 1] = {0};
+  for (uint32_t s = 0; s < ALPHABET; s++) {
+    count[lengths[s]]++;
+  }
+  count[0] = 0;
+
+  uint32_t next_code[MAX_CODE_LEN + 1] = {0};
+  uint32_t code = 0;
+  for (uint32_t len = 1; len <= MAX_CODE_LEN; len++) {
+    code = (code + count[len - 1]) << 1;
+    next_code[len] = code;
+  }
+  for (uint32_t s = 0; s < ALPHABET; s++) {
+    if (lengths[s] > 0) {
+      codes[s] = next_code[lengths[s]]++;
+    }
+  }
+}
+
+class HuffmanDecoder {
+ public:
+  // Returns false if the lengths do not describe a prefix code.
+  bool build(const uint8_t* lengths) {
+    uint32_t codes[ALPHABET];
+    memset(_count, 0, sizeof(_count));
+    for (uint32_t s = 0; s < ALPHABET; s++) {
+      if (lengths[s] > MAX_CODE_LEN) {
+        return false;
+      }
+      _count[lengths[s]]++;
+    }
+    _count[0] = 0;
+
+    int64_t left = 1;
+    for (uint32_t len = 1; len <= MAX_CODE_LEN; len++) {
+      left = (left << 1) - _count[len];
+      if (left < 0) {
+        return false;
+      }
+    }
+
+    uint32_t code = 0;
+    _offset[0] = 0;
+    _first[0] = 0;
+    for (uint32_t len = 1; len <= MAX_CODE_LEN; len++) {
+      code = (code + _count[len - 1]) << 1;
+      _first[len] = code;
+      _offset[len] = _offset[len - 1] + _count[len - 1];
+    }
+    uint32_t fill[MAX_CODE_LEN + 1];
+    memcpy(fill, _offset, sizeof(fill));
+    for (uint32_t s = 0; s < ALPHABET; s++) {
+      if (lengths[s] > 0) {
+        _sorted[fill[lengths[s]]++] = static_cast<uint16_t>(s);
+      }
+    }
+
+    canonical_codes(lengths, codes);
+    memset(_lookup_len, 0, sizeof(_lookup_len));
+    for (uint32_t s = 0; s < ALPHABET; s++) {
+      const uint32_t len = lengths[s];
+      if (len == 0 || len > LOOKUP_BITS) {
+        continue;
+      }
+      const uint32_t start = codes[s] << (LOOKUP_BITS - len);
+      const uint32_t end = start + (1 << (LOOKUP_BITS - len));
+      for (uint32_t i = start; i < end; i++) {
+        _lookup[i] = static_cast<uint16_t>(s);
+        _lookup_len[i] = static_cast<uint8_t>(len);
+      }
+    }
+    return true;
+  }
+
+  // Returns the next symbol, or -1 if the bits match no code.
+  int32_t decode(BitReader& reader) const {
+    const uint32_t bits = reader.peek(LOOKUP_BITS);
+    if (_lookup_len[bits] != 0) {
+      reader.skip(_lookup_len[bits]);
+      return _lookup[bits];
+    }
+    for (uint32_t len = LOOKUP_BITS + 1; len <= MAX_CODE_LEN; len++) {
+      const uint32_t code = reader.peek(len);
+      if (code >= _first[len] && code - _first[len] < _count[len]) {
+        reader.skip(len);
+        return _sorted[_offset[len] + code - _first[len]];
+      }
+    }
+    return -1;
+  }
+
+ private:
+  uint16_t _lookup[1 << LOOKUP_BITS];
+  uint8_t _lookup_len[1 << LOOKUP_BITS];
+  uint32_t _count[MAX_CODE_LEN + 1];
+  uint32_t _first[MAX_CODE_LEN + 1];
+  uint32_t _offset[MAX_CODE_LEN + 1];
+  uint16_t _sorted[ALPHABET];
+};
+
+static void push_zero_run(uint64_t run, std::vector<uint16_t>& symbols) {
+  if (run == 0) {
+    return;
+  }
+  run--;
+  while (true) {
+    symbols.push_back((run & 1) ? RUNB : RUNA);
+    if (run < 2) {
+      break;
+    }
+    run = (run - 2) / 2;
+  }
+}
+
+void entropy_encode(const unsigned char* in, uint32_t size,
+                    std::vector<uint8_t>& out) {
+  // Move-to-front with zero runs collapsed.
+  std::vector<uint16_t> symbols;
+  symbols.reserve(size / 2 + 2);
+  unsigned char order[256];
+  for (uint32_t c = 0; c < 256; c++) {
+    order[c] = static_cast<unsigned char>(c);
+  }
+  uint64_t run = 0;
+  for (uint32_t i = 0; i < size; i++) {
+    const unsigned char c = in[i];
+    if (order[0] == c) {
+      run++;
+      continue;
+    }
+    push_zero_run(run, symbols);
+    run = 0;
+
+    unsigned char prev = order[0];
+    order[0] = c;
+    uint32_t j = 1;
+    while (order[j] != c) {
+      std::swap(prev, order[j]);
+      j++;
+    }
+    order[j] = prev;
+    symbols.push_back(static_cast<uint16_t>(j + 1));
+  }
+  push_zero_run(run, symbols);
+  symbols.push_back(EOB);
+
+  uint64_t freq[ALPHABET] = {0};
+  for (uint64_t i = 0; i < symbols.size(); i++) {
+    freq[symbols[i]]++;
+  }
+  uint8_t lengths[ALPHABET];
+  uint32_t codes[ALPHABET];
+  huffman_code_lengths(freq, lengths);
+  canonical_codes(lengths, codes);
+
+  BitWriter writer(out);
+  for (uint32_t s = 0; s < ALPHABET; s++) {
+    writer.put(lengths[s], LENGTH_BITS);
+  }
+  for (uint64_t i = 0; i < symbols.size(); i++) {
+    writer.put(codes[symbols[i]], lengths[symbols[i]]);
+  }
+  writer.flush();
+}
+
+int32_t entropy_decode(const uint8_t* in, uint64_t in_size,
+                       unsigned char* out, uint32_t size) {
+  BitReader reader(in, in_size);
+  uint8_t lengths[ALPHABET];
+  for (uint32_t s = 0; s < ALPHABET; s++) {
+    lengths[s] = static_cast<uint8_t>(reader.get(LENGTH_BITS));
+  }
+  HuffmanDecoder* decoder = new HuffmanDecoder();
+  if (!decoder->build(lengths)) {
+    delete decoder;
+    return -1;
+  }
+
+  unsigned char order[256];
+  for (uint32_t c = 0; c < 256; c++) {
+    order[c] = static_cast<unsigned char>(c);
+  }
+  uint64_t pos = 0;
+  uint64_t run = 0;
+  uint64_t weight = 1;
+  int32_t status = -1;
+  while (true) {
+    const int32_t symbol = decoder->decode(reader);
+    if (symbol < 0) {
+      break;
+    }
+    if (symbol == static_cast<int32_t>(RUNA) ||
+        symbol == static_cast<int32_t>(RUNB)) {
+      run += (symbol + 1) * weight;
+      weight <<= 1;
+      if (run > size) {
+        break;
+      }
+      continue;
+    }
+
+    if (pos + run > size) {
+      break;
+    }
+    memset(out + pos, order[0], run);
+    pos += run;
+    run = 0;
+    weight = 1;
+
+    if (symbol == static_cast<int32_t>(EOB)) {
+      status = (pos == size && !reader.overrun()) ? 0 : -1;
+      break;
+    }
+    if (pos == size) {
+      break;
+    }
+    const uint32_t j = symbol - 1;
+    const unsigned char c = order[j];
+    memmove(order + 1, order, j);
+    order[0] = c;
+    out[pos++] = c;
+  }
+
+  delete decoder;
+  return status;
+}
@@ -0,0 +1,22 @@
+#ifndef __BWT_ENTROPY__
+#define __BWT_ENTROPY__
+
+#include <stdint.h>
+#include <vector>
+
+/*
+ * Second stage of the block-sorting compressor: move-to-front, zero-run
+ * coding with bzip2's RUNA/RUNB digits and a canonical Huffman code with a
+ * single table per segment. Segments are coded independently so a block can
+ * be split across threads.
+ */
+
+// Appends the coded segment to out.
+void entropy_encode(const unsigned char* in, uint32_t size,
+                    std::vector<uint8_t>& out);
+
+// Decodes exactly size characters into out. Returns -1 on corrupt input.
+int32_t entropy_decode(const uint8_t* in, uint64_t in_size,
+                       unsigned char* out, uint32_t size);
+
+#endif
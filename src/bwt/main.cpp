@@ -0,0 +1,263 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "mpi.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "../io/fileio.h"
+#include "compressor.h"
+
+using namespace std;
+
+/*
+ * Container: u32 magic, u32 version, u64 file size, u64 block size,
+ * u64 number of blocks, then number of blocks + 1 absolute offsets of the
+ * coded blocks. Every rank codes a contiguous range of blocks.
+ */
+const uint32_t BWTZ_MAGIC = 0x5a545742;  // "BWTZ"
+const uint32_t BWTZ_VERSION = 1;
+const uint64_t BWTZ_HEADER_SIZE = 32;
+const uint64_t DEFAULT_BLOCK_MB = 100;
+
+static int max_threads() {
+#ifdef _OPENMP
+  return omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+static void local_blocks(uint64_t num_blocks, int numprocs, int rank,
+                         uint64_t& first, uint64_t& last) {
+  const uint64_t p = static_cast<uint64_t>(numprocs);
+  first = num_blocks * rank / p;
+  last = num_blocks * (rank + 1) / p;
+}
+
+static bool read_range(const char* filename, uint64_t offset, char* buf,
+                       uint64_t count) {
+  std::ifstream t(filename, std::ifstream::binary);
+  t.seekg(offset);
+  t.read(buf, count);
+  return static_cast<uint64_t>(t.gcount()) == count;
+}
+
+static int32_t all_ok(int32_t status, MPI_Comm comm) {
+  int32_t global = 0;
+  MPI_Allreduce(&status, &global, 1, MPI_INT, MPI_MIN, comm);
+  return global;
+}
+
+static int32_t compress(const char* input, const char* output,
+                        uint64_t block_size, int numprocs, int rank) {
+  const uint64_t file_size = get_filesize(input);
+  const uint64_t num_blocks = (file_size + block_size - 1) / block_size;
+  uint64_t first, last;
+  local_blocks(num_blocks, numprocs, rank, first, last);
+  if (!rank) {
+    fprintf(stdout, "Compressing %lu bytes in %lu blocks of %lu bytes\n",
+            file_size, num_blocks, block_size);
+  }
+
+  // With a single local block the threads work inside the block instead.
+  std::vector<std::vector<uint8_t> > coded(last - first);
+  int32_t status = 0;
+#pragma omp parallel for schedule(dynamic, 1) if (last - first > 1)
+  for (int64_t b = first; b < static_cast<int64_t>(last); b++) {
+    const uint64_t begin = b * block_size;
+    const uint64_t size = std::min(block_size, file_size - begin);
+    char* data = new (std::nothrow) char[size];
+    if (data == NULL || !read_range(input, begin, data, size) ||
+        compress_block(reinterpret_cast<unsigned char*>(data),
+                       static_cast<uint32_t>(size), coded[b - first]) < 0) {
+      status = -1;
+    }
+    delete[] data;
+  }
+  if (all_ok(status, MPI_COMM_WORLD) < 0) {
+    return -1;
+  }
+
+  // Every rank learns all coded sizes to place its blocks.
+  std::vector<uint64_t> offsets(num_blocks + 1, 0);
+  for (uint64_t b = first; b < last; b++) {
+    offsets[b + 1] = coded[b - first].size();
+  }
+  MPI_Allreduce(MPI_IN_PLACE, &offsets[0], num_blocks + 1,
+                MPI_UNSIGNED_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+  offsets[0] = BWTZ_HEADER_SIZE + (num_blocks + 1) * sizeof(uint64_t);
+  for (uint64_t b = 0; b < num_blocks; b++) {
+    offsets[b + 1] += offsets[b];
+  }
+
+  MPI_File fh;
+  if (MPI_File_open(MPI_COMM_WORLD, const_cast<char*>(output),
+                    MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL,
+                    &fh) != MPI_SUCCESS) {
+    return -1;
+  }
+  MPI_File_set_size(fh, offsets[num_blocks]);
+  if (!rank) {
+    std::vector<uint8_t> header(BWTZ_HEADER_SIZE);
+    memcpy(&header[0], &BWTZ_MAGIC, 4);
+    memcpy(&header[4], &BWTZ_VERSION, 4);
+    memcpy(&header[8], &file_size, 8);
+    memcpy(&header[16], &block_size, 8);
+    memcpy(&header[24], &num_blocks, 8);
+    if (file_write_at(fh, 0, reinterpret_cast<char*>(&header[0]),
+                      BWTZ_HEADER_SIZE) < 0 ||
+        file_write_at(fh, BWTZ_HEADER_SIZE,
+                      reinterpret_cast<char*>(&offsets[0]),
+                      (num_blocks + 1) * sizeof(uint64_t)) < 0) {
+      status = -1;
+    }
+  }
+  for (uint64_t b = first; b < last && status == 0; b++) {
+    const std::vector<uint8_t>& block = coded[b - first];
+    if (file_write_at(fh, offsets[b],
+                      reinterpret_cast<const char*>(&block[0]),
+                      block.size()) < 0) {
+      status = -1;
+    }
+  }
+  MPI_File_close(&fh);
+
+  if (!rank) {
+    fprintf(stdout, "Compressed size %lu (%.3f bits per byte)\n",
+            offsets[num_blocks],
+            file_size ? 8.0 * offsets[num_blocks] / file_size : 0.0);
+  }
+  return all_ok(status, MPI_COMM_WORLD);
+}
+
+static int32_t decompress(const char* input, const char* output,
+                          int numprocs, int rank) {
+  uint32_t magic = 0, version = 0;
+  uint64_t file_size = 0, block_size = 0, num_blocks = 0;
+  std::vector<uint8_t> header(BWTZ_HEADER_SIZE);
+  if (!read_range(input, 0, reinterpret_cast<char*>(&header[0]),
+                  BWTZ_HEADER_SIZE)) {
+    return -1;
+  }
+  memcpy(&magic, &header[0], 4);
+  memcpy(&version, &header[4], 4);
+  memcpy(&file_size, &header[8], 8);
+  memcpy(&block_size, &header[16], 8);
+  memcpy(&num_blocks, &header[24], 8);
+  if (magic != BWTZ_MAGIC || version != BWTZ_VERSION || block_size == 0 ||
+      num_blocks != (file_size + block_size - 1) / block_size) {
+    return -1;
+  }
+  std::vector<uint64_t> offsets(num_blocks + 1);
+  if (!read_range(input, BWTZ_HEADER_SIZE,
+                  reinterpret_cast<char*>(&offsets[0]),
+                  (num_blocks + 1) * sizeof(uint64_t))) {
+    return -1;
+  }
+
+  uint64_t first, last;
+  local_blocks(num_blocks, numprocs, rank, first, last);
+
+  MPI_File fh;
+  if (MPI_File_open(MPI_COMM_WORLD, const_cast<char*>(output),
+                    MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL,
+                    &fh) != MPI_SUCCESS) {
+    return -1;
+  }
+  MPI_File_set_size(fh, file_size);
+
+  // Decode as many blocks at a time as there are threads, then write them
+  // from the main thread.
+  const uint64_t batch = static_cast<uint64_t>(max_threads());
+  int32_t status = 0;
+  for (uint64_t start = first; start < last && status == 0; start += batch) {
+    const uint64_t end = std::min(last, start + batch);
+    std::vector<char*> decoded(end - start, static_cast<char*>(NULL));
+#pragma omp parallel for schedule(dynamic, 1) if (end - start > 1)
+    for (int64_t b = start; b < static_cast<int64_t>(end); b++) {
+      const uint64_t size = std::min(block_size, file_size - b * block_size);
+      const uint64_t coded_size = offsets[b + 1] - offsets[b];
+      char* coded = new (std::nothrow) char[coded_size];
+      char* data = new (std::nothrow) char[size + 1];
+      if (offsets[b + 1] < offsets[b] || coded == NULL || data == NULL ||
+          !read_range(input, offsets[b], coded, coded_size) ||
+          decompress_block(reinterpret_cast<uint8_t*>(coded), coded_size,
+                           reinterpret_cast<unsigned char*>(data),
+                           static_cast<uint32_t>(size)) < 0) {
+        status = -1;
+      }
+      delete[] coded;
+      decoded[b - start] = data;
+    }
+    for (uint64_t b = start; b < end; b++) {
+      const uint64_t size = std::min(block_size, file_size - b * block_size);
+      if (status == 0 &&
+          file_write_at(fh, b * block_size, decoded[b - start], size) < 0) {
+        status = -1;
+      }
+      delete[] decoded[b - start];
+    }
+  }
+  MPI_File_close(&fh);
+  return all_ok(status, MPI_COMM_WORLD);
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 4 || argc > 5 ||
+      (strcmp(argv[1], "c") != 0 && strcmp(argv[1], "d") != 0)) {
+    fprintf(stdout, "c <input file> <output file> [block size in MB]\n");
+    fprintf(stdout, "d <input file> <output file>\n");
+    exit(1);
+  }
+  int numprocs;
+  int rank;
+
+  MPI_Init(&argc, &argv);
+  MPI_Comm_size(MPI_COMM_WORLD, &numprocs);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+  if (rank == 0) {
+    fprintf(stdout, "There are %d total nodes.\n", numprocs);
+    ifstream f(argv[2]);
+    if (!f.good()) {
+      f.close();
+      fprintf(stdout, "File doesn't exist\n");
+      MPI_Abort(MPI_COMM_WORLD, -1);
+    } else {
+      f.close();
+    }
+  }
+
+  uint64_t block_mb = DEFAULT_BLOCK_MB;
+  if (argc == 5) {
+    block_mb = strtoull(argv[4], NULL, 10);
+  }
+  // Blocks are indexed with 32-bit suffix arrays.
+  if (block_mb == 0 || block_mb > 2047) {
+    if (!rank) fprintf(stdout, "Block size must be in [1, 2047] MB\n");
+    MPI_Finalize();
+    exit(1);
+  }
+
+  MPI_Barrier(MPI_COMM_WORLD);
+  double elapsed = MPI::Wtime();
+  int32_t status;
+  if (argv[1][0] == 'c') {
+    status = compress(argv[2], argv[3], block_mb << 20, numprocs, rank);
+  } else {
+    status = decompress(argv[2], argv[3], numprocs, rank);
+  }
+  if (status < 0) {
+    if (!rank) fprintf(stderr, "Failed on %s, terminating.\n", argv[2]);
+    MPI_Finalize();
+    exit(-1);
+  }
+
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (!rank) fprintf(stdout, "Total time: %f\n", MPI::Wtime() - elapsed);
+
+  MPI_Finalize();
+  exit(0);
+}
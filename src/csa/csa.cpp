@@ -0,0 +1,392 @@
+#include "csa.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <new>
+
+const uint32_t CSA_MAGIC = 0x31415343;  // "CSA1"
+
+static inline uint64_t sa_entry(const TextIndex& index, uint64_t i) {
+  if (index.width == 8) {
+    return static_cast<const uint64_t*>(index.suffix_array)[i];
+  }
+  return static_cast<const uint32_t*>(index.suffix_array)[i];
+}
+
+static inline uint32_t log2_floor(uint64_t x) {
+  return 63 - __builtin_clzll(x);
+}
+
+// Bits of a delta code for gap >= 1: gamma(N + 1), then the low N bits of
+// gap, N = floor(log2 gap).
+static inline uint64_t delta_length(uint64_t gap) {
+  const uint32_t n = log2_floor(gap);
+  return 2 * log2_floor(n + 1) + 1 + n;
+}
+
+static inline uint64_t get_bits(const uint64_t* bits, uint64_t pos,
+                                uint32_t width) {
+  if (width == 0) {
+    return 0;
+  }
+  const uint64_t word = pos >> 6;
+  const uint32_t offset = pos & 63;
+  uint64_t value = bits[word] >> offset;
+  if (offset + width > 64) {
+    value |= bits[word + 1] << (64 - offset);
+  }
+  return width == 64 ? value : value & ((1ULL << width) - 1);
+}
+
+// Blocks of the stream are written concurrently and may share their first
+// and last words, so bits are or-ed in atomically.
+static inline void put_bits(uint64_t* bits, uint64_t pos, uint64_t value,
+                            uint32_t width) {
+  if (width == 0) {
+    return;
+  }
+  if (width < 64) {
+    value &= (1ULL << width) - 1;
+  }
+  const uint64_t word = pos >> 6;
+  const uint32_t offset = pos & 63;
+  __sync_fetch_and_or(&bits[word], value << offset);
+  if (offset + width > 64) {
+    __sync_fetch_and_or(&bits[word + 1], value >> (64 - offset));
+  }
+}
+
+static inline void put_delta(uint64_t* bits, uint64_t& pos, uint64_t gap) {
+  const uint32_t n = log2_floor(gap);
+  const uint32_t z = log2_floor(n + 1);
+  put_bits(bits, pos + z, 1, 1);
+  put_bits(bits, pos + z + 1, n + 1, z);
+  pos += 2 * z + 1;
+  put_bits(bits, pos, gap, n);
+  pos += n;
+}
+
+static inline uint64_t get_delta(const uint64_t* bits, uint64_t& pos) {
+  const uint32_t z = __builtin_ctzll(get_bits(bits, pos, 64));
+  const uint32_t n = ((1U << z) | get_bits(bits, pos + z + 1, z)) - 1;
+  pos += 2 * z + 1;
+  const uint64_t gap = (1ULL << n) | get_bits(bits, pos, n);
+  pos += n;
+  return gap;
+}
+
+PsiCSA::PsiCSA() : size_(0), sigma_(1), sa_step_(0), isa_step_(0) {
+  memset(code_, 0, sizeof(code_));
+  memset(symbol_, 0, sizeof(symbol_));
+  memset(first_row_, 0, sizeof(first_row_));
+}
+
+int32_t PsiCSA::build(const TextIndex& index, uint32_t sa_step,
+                      uint32_t isa_step) {
+  if (sa_step == 0 || isa_step == 0) {
+    return -1;
+  }
+  const unsigned char* text = index.text;
+  const uint64_t n = index.size;
+  const uint64_t rows = n + 1;
+  size_ = n;
+  sa_step_ = sa_step;
+  isa_step_ = isa_step;
+
+  uint64_t counts[256];
+  memset(counts, 0, sizeof(counts));
+#pragma omp parallel for schedule(static) reduction(+ : counts[:256])
+  for (uint64_t i = 0; i < n; i++) {
+    counts[text[i]]++;
+  }
+  memset(code_, 0, sizeof(code_));
+  sigma_ = 1;
+  first_row_[0] = 0;
+  first_row_[1] = 1;
+  for (uint32_t c = 0; c < 256; c++) {
+    if (counts[c] > 0) {
+      code_[c] = sigma_;
+      symbol_[sigma_] = c;
+      first_row_[sigma_ + 1] = first_row_[sigma_] + counts[c];
+      sigma_++;
+    }
+  }
+
+  // Rows of text positions; position n is the $ row.
+  uint64_t* isa = new (std::nothrow) uint64_t[rows];
+  if (isa == NULL) {
+    return -1;
+  }
+  isa[n] = 0;
+#pragma omp parallel for schedule(static)
+  for (uint64_t i = 0; i < n; i++) {
+    isa[sa_entry(index, i)] = i + 1;
+  }
+
+  // psi plus the code offset, computed from SA and ISA on the fly.
+  const uint16_t* code = code_;
+  auto psi_value = [&](uint64_t row) -> uint64_t {
+    if (row == 0) {
+      return isa[0];
+    }
+    const uint64_t p = sa_entry(index, row - 1);
+    return isa[p + 1] + code[text[p]] * rows;
+  };
+
+  const uint64_t num_blocks = (rows + CSA_PSI_SAMPLE - 1) / CSA_PSI_SAMPLE;
+  psi_samples_.assign(num_blocks, 0);
+  psi_pointers_.assign(num_blocks + 1, 0);
+#pragma omp parallel for schedule(static)
+  for (uint64_t b = 0; b < num_blocks; b++) {
+    const uint64_t begin = b * CSA_PSI_SAMPLE;
+    const uint64_t end = std::min(begin + CSA_PSI_SAMPLE, rows);
+    uint64_t prev = psi_value(begin);
+    uint64_t bits = 0;
+    psi_samples_[b] = prev;
+    for (uint64_t r = begin + 1; r < end; r++) {
+      const uint64_t v = psi_value(r);
+      bits += delta_length(v - prev);
+      prev = v;
+    }
+    psi_pointers_[b + 1] = bits;
+  }
+  for (uint64_t b = 0; b < num_blocks; b++) {
+    psi_pointers_[b + 1] += psi_pointers_[b];
+  }
+  psi_bits_.assign(psi_pointers_[num_blocks] / 64 + 2, 0);
+  uint64_t* stream = &psi_bits_[0];
+#pragma omp parallel for schedule(static)
+  for (uint64_t b = 0; b < num_blocks; b++) {
+    const uint64_t begin = b * CSA_PSI_SAMPLE;
+    const uint64_t end = std::min(begin + CSA_PSI_SAMPLE, rows);
+    uint64_t prev = psi_samples_[b];
+    uint64_t pos = psi_pointers_[b];
+    for (uint64_t r = begin + 1; r < end; r++) {
+      const uint64_t v = psi_value(r);
+      put_delta(stream, pos, v - prev);
+      prev = v;
+    }
+  }
+  psi_pointers_.pop_back();
+
+  // Rows of every sa_step-th position, and the $ row.
+  const uint64_t num_words = (rows + 63) / 64;
+  sa_marks_.assign(num_words, 0);
+#pragma omp parallel for schedule(static)
+  for (uint64_t w = 0; w < num_words; w++) {
+    uint64_t word = 0;
+    const uint64_t end = std::min((w + 1) * 64, rows);
+    for (uint64_t r = w * 64; r < end; r++) {
+      if (r == 0 || sa_entry(index, r - 1) % sa_step == 0) {
+        word |= 1ULL << (r & 63);
+      }
+    }
+    sa_marks_[w] = word;
+  }
+  sa_ranks_.assign(num_words / 8 + 2, 0);
+  for (uint64_t w = 0; w < num_words; w++) {
+    sa_ranks_[w / 8 + 1] += __builtin_popcountll(sa_marks_[w]);
+  }
+  for (uint64_t k = 1; k < sa_ranks_.size(); k++) {
+    sa_ranks_[k] += sa_ranks_[k - 1];
+  }
+  sa_values_.assign(sa_ranks_.back(), 0);
+#pragma omp parallel for schedule(static)
+  for (uint64_t r = 0; r < rows; r++) {
+    if (sampled(r)) {
+      sa_values_[sample_rank(r)] = r == 0 ? n : sa_entry(index, r - 1);
+    }
+  }
+
+  isa_values_.assign((n + isa_step - 1) / isa_step, 0);
+#pragma omp parallel for schedule(static)
+  for (uint64_t j = 0; j < isa_values_.size(); j++) {
+    isa_values_[j] = isa[j * isa_step];
+  }
+  delete[] isa;
+  return 0;
+}
+
+uint64_t PsiCSA::code_of_row(uint64_t row) const {
+  return std::upper_bound(first_row_, first_row_ + sigma_ + 1, row) -
+         first_row_ - 1;
+}
+
+uint64_t PsiCSA::psi(uint64_t row) const {
+  const uint64_t b = row / CSA_PSI_SAMPLE;
+  uint64_t value = psi_samples_[b];
+  uint64_t pos = psi_pointers_[b];
+  for (uint64_t r = b * CSA_PSI_SAMPLE; r < row; r++) {
+    value += get_delta(&psi_bits_[0], pos);
+  }
+  return value - code_of_row(row) * (size_ + 1);
+}
+
+// First row whose psi plus code offset is at least value, or size + 1.
+uint64_t PsiCSA::psi_lower_bound(uint64_t value) const {
+  uint64_t b =
+      std::lower_bound(psi_samples_.begin(), psi_samples_.end(), value) -
+      psi_samples_.begin();
+  if (b == 0) {
+    return 0;
+  }
+  b--;
+  uint64_t v = psi_samples_[b];
+  uint64_t pos = psi_pointers_[b];
+  const uint64_t end = std::min((b + 1) * CSA_PSI_SAMPLE, size_ + 1);
+  for (uint64_t r = b * CSA_PSI_SAMPLE + 1; r < end; r++) {
+    v += get_delta(&psi_bits_[0], pos);
+    if (v >= value) {
+      return r;
+    }
+  }
+  return end;
+}
+
+bool PsiCSA::sampled(uint64_t row) const {
+  return (sa_marks_[row >> 6] >> (row & 63)) & 1;
+}
+
+uint64_t PsiCSA::sample_rank(uint64_t row) const {
+  const uint64_t word = row >> 6;
+  uint64_t rank = sa_ranks_[word >> 3];
+  for (uint64_t w = word & ~7ULL; w < word; w++) {
+    rank += __builtin_popcountll(sa_marks_[w]);
+  }
+  return rank +
+         __builtin_popcountll(sa_marks_[word] & ((1ULL << (row & 63)) - 1));
+}
+
+uint64_t PsiCSA::lookup(uint64_t i) const {
+  uint64_t row = i + 1;
+  uint64_t steps = 0;
+  while (!sampled(row)) {
+    row = psi(row);
+    steps++;
+  }
+  return sa_values_[sample_rank(row)] - steps;
+}
+
+uint64_t PsiCSA::inverse(uint64_t p) const {
+  uint64_t row = isa_values_[p / isa_step_];
+  for (uint64_t k = p % isa_step_; k > 0; k--) {
+    row = psi(row);
+  }
+  return row - 1;
+}
+
+void PsiCSA::extract(uint64_t p, uint64_t length, unsigned char* out) const {
+  if (length == 0) {
+    return;
+  }
+  uint64_t row = inverse(p) + 1;
+  for (uint64_t k = 0; k < length; k++) {
+    out[k] = symbol_[code_of_row(row)];
+    row = psi(row);
+  }
+}
+
+void PsiCSA::find(const unsigned char* pattern, uint32_t length,
+                  uint64_t& begin, uint64_t& end) const {
+  begin = end = 0;
+  if (length == 0) {
+    end = size_;
+    return;
+  }
+  uint64_t c = code_[pattern[length - 1]];
+  if (c == 0) {
+    return;
+  }
+  uint64_t lo = first_row_[c], hi = first_row_[c + 1];
+  // The rows of c whose psi falls in [lo, hi) are contiguous.
+  for (int64_t k = static_cast<int64_t>(length) - 2; k >= 0; k--) {
+    c = code_[pattern[k]];
+    if (c == 0) {
+      return;
+    }
+    lo = psi_lower_bound(lo + c * (size_ + 1));
+    hi = psi_lower_bound(hi + c * (size_ + 1));
+    if (lo >= hi) {
+      return;
+    }
+  }
+  begin = lo - 1;
+  end = hi - 1;
+}
+
+uint64_t PsiCSA::size_in_bytes() const {
+  return sizeof(*this) +
+         8 * (psi_bits_.size() + psi_samples_.size() + psi_pointers_.size() +
+              sa_marks_.size() + sa_ranks_.size() + sa_values_.size() +
+              isa_values_.size());
+}
+
+static bool write_vector(FILE* f, const std::vector<uint64_t>& v) {
+  const uint64_t count = v.size();
+  return fwrite(&count, sizeof(count), 1, f) == 1 &&
+         fwrite(v.data(), sizeof(uint64_t), count, f) == count;
+}
+
+static bool read_vector(FILE* f, std::vector<uint64_t>& v) {
+  uint64_t count;
+  if (fread(&count, sizeof(count), 1, f) != 1) {
+    return false;
+  }
+  v.resize(count);
+  return fread(v.data(), sizeof(uint64_t), count, f) == count;
+}
+
+/*
+ * File layout (host byte order): u32 magic, u32 sigma, u32 sa_step,
+ * u32 isa_step, u64 size, the u16 code table, first_row[258] as u64,
+ * then each vector as a u64 count followed by its words.
+ */
+int32_t PsiCSA::save(const char* filename) const {
+  FILE* f = fopen(filename, "wb");
+  if (f == NULL) {
+    return -1;
+  }
+  const uint32_t header[4] = {CSA_MAGIC, sigma_, sa_step_, isa_step_};
+  bool ok = fwrite(header, sizeof(header), 1, f) == 1 &&
+            fwrite(&size_, sizeof(size_), 1, f) == 1 &&
+            fwrite(code_, sizeof(code_), 1, f) == 1 &&
+            fwrite(first_row_, sizeof(first_row_), 1, f) == 1 &&
+            write_vector(f, psi_bits_) && write_vector(f, psi_samples_) &&
+            write_vector(f, psi_pointers_) && write_vector(f, sa_marks_) &&
+            write_vector(f, sa_ranks_) && write_vector(f, sa_values_) &&
+            write_vector(f, isa_values_);
+  ok = (fclose(f) == 0) && ok;
+  return ok ? 0 : -1;
+}
+
+int32_t PsiCSA::load(const char* filename) {
+  FILE* f = fopen(filename, "rb");
+  if (f == NULL) {
+    return -1;
+  }
+  uint32_t header[4];
+  bool ok = fread(header, sizeof(header), 1, f) == 1 &&
+            header[0] == CSA_MAGIC && header[1] >= 1 && header[1] <= 257 &&
+            fread(&size_, sizeof(size_), 1, f) == 1 &&
+            fread(code_, sizeof(code_), 1, f) == 1 &&
+            fread(first_row_, sizeof(first_row_), 1, f) == 1 &&
+            read_vector(f, psi_bits_) && read_vector(f, psi_samples_) &&
+            read_vector(f, psi_pointers_) && read_vector(f, sa_marks_) &&
+            read_vector(f, sa_ranks_) && read_vector(f, sa_values_) &&
+            read_vector(f, isa_values_);
+  fclose(f);
+  if (!ok) {
+    return -1;
+  }
+  sigma_ = header[1];
+  sa_step_ = header[2];
+  isa_step_ = header[3];
+  memset(symbol_, 0, sizeof(symbol_));
+  for (uint32_t c = 0; c < 256; c++) {
+    if (code_[c] != 0) {
+      symbol_[code_[c]] = c;
+    }
+  }
+  return 0;
+}
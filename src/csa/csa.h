@@ -0,0 +1,81 @@
+#ifndef __CSA_PSI__
+#define __CSA_PSI__
+
+#include <stdint.h>
+#include <vector>
+#include "../search/index.h"
+
+/*
+ * Compressed suffix array after Sadakane (New text indexing functionalities
+ * of the compressed suffix arrays, 2003).
+ *
+ * Rows 0..size are the sorted suffixes of text$, row 0 being the empty
+ * suffix $, so row i + 1 is suffix array index i of the builders' output.
+ * psi(i) is the row of the suffix one position to the right of row i's.
+ * Within the rows of one character psi increases, so psi(i) + c * (size + 1),
+ * with c the code of row i's first character, increases over all rows.
+ * That sequence is stored as delta-coded gaps with an absolute sample every
+ * CSA_PSI_SAMPLE rows, which takes close to the empirical entropy of the
+ * text for the gaps. Suffix array values are kept for the rows of every
+ * sa_step-th text position and inverse values for every isa_step-th position;
+ * everything else is reached by walking psi.
+ */
+const uint32_t CSA_PSI_SAMPLE = 32;
+const uint32_t CSA_SA_STEP = 32;
+const uint32_t CSA_ISA_STEP = 64;
+
+class PsiCSA {
+ public:
+  PsiCSA();
+
+  // Builds from the text and suffix array loaded by load_index.
+  int32_t build(const TextIndex& index, uint32_t sa_step = CSA_SA_STEP,
+                uint32_t isa_step = CSA_ISA_STEP);
+
+  int32_t save(const char* filename) const;
+  int32_t load(const char* filename);
+
+  uint64_t size() const { return size_; }
+  uint64_t size_in_bytes() const;
+
+  // Row of the suffix following row i's.
+  uint64_t psi(uint64_t row) const;
+
+  // Suffix array value at index i, 0 <= i < size().
+  uint64_t lookup(uint64_t i) const;
+
+  // Suffix array index of text position p, 0 <= p < size().
+  uint64_t inverse(uint64_t p) const;
+
+  // Copies text[p, p + length) into out.
+  void extract(uint64_t p, uint64_t length, unsigned char* out) const;
+
+  // Suffix array interval [begin, end) of the suffixes starting with the
+  // pattern, found by backward search over psi.
+  void find(const unsigned char* pattern, uint32_t length, uint64_t& begin,
+            uint64_t& end) const;
+
+ private:
+  uint64_t code_of_row(uint64_t row) const;
+  uint64_t psi_lower_bound(uint64_t value) const;
+  bool sampled(uint64_t row) const;
+  uint64_t sample_rank(uint64_t row) const;
+
+  uint64_t size_;
+  uint32_t sigma_;  // codes in use, $ included
+  uint32_t sa_step_;
+  uint32_t isa_step_;
+  uint16_t code_[256];  // 0 for characters absent from the text
+  unsigned char symbol_[257];
+  uint64_t first_row_[258];  // first row of each code, by code
+
+  std::vector<uint64_t> psi_bits_;
+  std::vector<uint64_t> psi_samples_;   // psi + code offset, every sample
+  std::vector<uint64_t> psi_pointers_;  // bit position of each sample block
+  std::vector<uint64_t> sa_marks_;      // rows with a kept SA value
+  std::vector<uint64_t> sa_ranks_;      // marks before every 8th word
+  std::vector<uint64_t> sa_values_;
+  std::vector<uint64_t> isa_values_;
+};
+
+#endif
@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "../search/index.h"
+#include "csa.h"
+
+using namespace std;
+
+static void usage(const char* name) {
+  fprintf(stderr,
+          "Usage: %s build <text> <suffix array> <index> [<sa step> "
+          "[<isa step>]]\n"
+          "       %s locate <index> <patterns> <output>\n",
+          name, name);
+}
+
+static int32_t build(int argc, char* argv[]) {
+  uint32_t sa_step = CSA_SA_STEP, isa_step = CSA_ISA_STEP;
+  if (argc > 5) sa_step = atoi(argv[5]);
+  if (argc > 6) isa_step = atoi(argv[6]);
+
+  TextIndex index;
+  if (load_index(argv[2], argv[3], index) < 0) {
+    fprintf(stderr, "Failed to load %s and %s\n", argv[2], argv[3]);
+    return -1;
+  }
+  PsiCSA csa;
+  int32_t status = csa.build(index, sa_step, isa_step);
+  free_index(index);
+  if (status < 0) {
+    fprintf(stderr, "Failed to build the compressed suffix array\n");
+    return -1;
+  }
+  if (csa.save(argv[4]) < 0) {
+    fprintf(stderr, "Failed to write %s\n", argv[4]);
+    return -1;
+  }
+  fprintf(stdout, "Indexed %lu characters in %lu bytes (%.3f bits per "
+          "character)\n", csa.size(), csa.size_in_bytes(),
+          csa.size() ? 8.0 * csa.size_in_bytes() / csa.size() : 0.0);
+  return 0;
+}
+
+// One pattern per line; each output line is the line number, the count and
+// up to MAX_LISTED_OCC text positions.
+static int32_t locate(char* argv[]) {
+  PsiCSA csa;
+  if (csa.load(argv[2]) < 0) {
+    fprintf(stderr, "Failed to load %s\n", argv[2]);
+    return -1;
+  }
+  vector<string> patterns;
+  if (read_lines(argv[3], patterns) < 0) {
+    fprintf(stderr, "Failed to read %s\n", argv[3]);
+    return -1;
+  }
+
+  vector<string> lines(patterns.size());
+#pragma omp parallel for schedule(dynamic, 16)
+  for (size_t q = 0; q < patterns.size(); q++) {
+    uint64_t begin, end;
+    csa.find(reinterpret_cast<const unsigned char*>(patterns[q].data()),
+             patterns[q].size(), begin, end);
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%zu\t%lu", q, end - begin);
+    lines[q] = buf;
+    for (uint64_t i = begin; i < end && i < begin + MAX_LISTED_OCC; i++) {
+      snprintf(buf, sizeof(buf), "%c%lu", i == begin ? '\t' : ',',
+               csa.lookup(i));
+      lines[q] += buf;
+    }
+    lines[q] += '\n';
+  }
+
+  FILE* f = fopen(argv[4], "w");
+  if (f == NULL) {
+    fprintf(stderr, "Failed to write %s\n", argv[4]);
+    return -1;
+  }
+  for (size_t q = 0; q < lines.size(); q++) {
+    fputs(lines[q].c_str(), f);
+  }
+  return fclose(f) == 0 ? 0 : -1;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc >= 5 && strcmp(argv[1], "build") == 0) {
+    return build(argc, argv) < 0 ? 1 : 0;
+  }
+  if (argc == 5 && strcmp(argv[1], "locate") == 0) {
+    return locate(argv) < 0 ? 1 : 0;
+  }
+  usage(argv[0]);
+  return 1;
+}
@@ -0,0 +1,83 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <omp.h>
+#include "../search/disk_index.h"
+#include "../search/index.h"
+
+using namespace std;
+
+// Patterns searched together.
+const uint32_t DISK_BATCH = 256;
+
+// One pattern per line, answered from the files without loading them; each
+// output line is the line number, the count and up to MAX_LISTED_OCC text
+// positions.
+int main(int argc, char* argv[]) {
+  if (argc != 5) {
+    fprintf(stderr, "Usage: %s <text> <suffix array> <patterns> <output>\n",
+            argv[0]);
+    return 1;
+  }
+  DiskIndex index;
+  double elapsed = omp_get_wtime();
+  if (index.open(argv[1], argv[2]) < 0) {
+    fprintf(stderr, "Failed to open %s and %s\n", argv[1], argv[2]);
+    return 1;
+  }
+  fprintf(stdout, "Sampled %lu characters into %lu bytes in %f s\n",
+          index.size(), index.sample_bytes(), omp_get_wtime() - elapsed);
+
+  vector<string> patterns;
+  if (read_lines(argv[3], patterns) < 0) {
+    fprintf(stderr, "Failed to read %s\n", argv[3]);
+    return 1;
+  }
+
+  elapsed = omp_get_wtime();
+  const uint64_t num_patterns = patterns.size();
+  vector<uint64_t> begin(num_patterns), end(num_patterns);
+  vector<vector<uint64_t> > positions(num_patterns);
+  int32_t status = 0;
+  for (uint64_t first = 0; first < num_patterns && status == 0;
+       first += DISK_BATCH) {
+    const uint32_t count = min<uint64_t>(DISK_BATCH, num_patterns - first);
+    vector<const unsigned char*> batch(count);
+    vector<uint32_t> lengths(count);
+    for (uint32_t j = 0; j < count; j++) {
+      batch[j] = reinterpret_cast<const unsigned char*>(
+          patterns[first + j].data());
+      lengths[j] = patterns[first + j].size();
+    }
+    status = index.find_ranges(batch.data(), lengths.data(), count,
+                               &begin[first], &end[first]);
+  }
+#pragma omp parallel for schedule(dynamic, 16) reduction(min : status)
+  for (uint64_t q = 0; q < num_patterns; q++) {
+    if (index.entries(begin[q], min(end[q], begin[q] + MAX_LISTED_OCC),
+                      positions[q]) < 0) {
+      status = -1;
+    }
+  }
+  if (status < 0) {
+    fprintf(stderr, "Reading the index failed\n");
+    return 1;
+  }
+  fprintf(stdout, "Answered %lu patterns in %f s\n", num_patterns,
+          omp_get_wtime() - elapsed);
+
+  FILE* f = fopen(argv[4], "w");
+  if (f == NULL) {
+    fprintf(stderr, "Failed to write %s\n", argv[4]);
+    return 1;
+  }
+  for (uint64_t q = 0; q < num_patterns; q++) {
+    fprintf(f, "%lu\t%lu", q, end[q] - begin[q]);
+    for (size_t i = 0; i < positions[q].size(); i++) {
+      fprintf(f, "%c%lu", i == 0 ? '\t' : ',', positions[q][i]);
+    }
+    fprintf(f, "\n");
+  }
+  return fclose(f) == 0 ? 0 : 1;
+}
@@ -1,21 +1,14 @@
 #include "fileio.h"
 
+#include <new>
+
 size_t get_filesize(const char* filename) {
   std::ifstream in(filename, std::ifstream::ate | std::ifstream::binary);
   return in.tellg();
 }
 
-char* file_block_decompose(const char* filename, uint64_t& size,
-                           uint64_t& file_size, uint64_t& offset, MPI_Comm comm,
-                           uint64_t alignment, uint32_t extra) {
-  // get size of input file
-  file_size = get_filesize(filename);
-
-  // get communication parameters
-  int32_t p, rank;
-  MPI_Comm_size(comm, &p);
-  MPI_Comm_rank(comm, &rank);
-
+void block_range(uint64_t file_size, int32_t p, int32_t rank,
+                 uint64_t alignment, uint64_t& offset, uint64_t& size) {
   const uint64_t num_aligned_blocks = (file_size + alignment - 1) / alignment;
   const uint32_t mod = num_aligned_blocks % p;
 
@@ -37,33 +30,154 @@ char* file_block_decompose(const char* filename, uint64_t& size,
   } else {
     size = proc_size - (alignment - (file_size % alignment));
   }
+}
+
+// Splits the file as file_block_decompose does; returns whether this is the
+// last process.
+static bool decompose(const char* filename, uint64_t& size,
+                      uint64_t& file_size, uint64_t& offset, MPI_Comm comm,
+                      uint64_t alignment) {
+  // get size of input file
+  file_size = get_filesize(filename);
+
+  // get communication parameters
+  int32_t p, rank;
+  MPI_Comm_size(comm, &p);
+  MPI_Comm_rank(comm, &rank);
+  block_range(file_size, p, rank, alignment, offset, size);
 
   if (rank == 0) {
     fprintf(stdout, "Filesize %zu and block size %zu\n", file_size, size);
   }
+  return rank == p - 1;
+}
 
+// Reads size + extra characters at offset; the last block is padded with 0.
+static void read_block(const char* filename, uint64_t size, uint64_t offset,
+                       uint32_t extra, bool last, char* data) {
   // open file
   std::ifstream t(filename);
 
   t.seekg(offset);
+  if (!last) {
+    t.readsome(data, size + extra);
+  } else {
+    t.readsome(data, size);
+    for (uint32_t i = 0; i < extra; i++) {
+      data[size + i] = 0;
+    }
+  }
+}
+
+char* file_block_decompose(const char* filename, uint64_t& size,
+                           uint64_t& file_size, uint64_t& offset, MPI_Comm comm,
+                           uint64_t alignment, uint32_t extra) {
+  const bool last =
+      decompose(filename, size, file_size, offset, comm, alignment);
   char* data;
   try {
     data = new char[size + extra];
   } catch (std::bad_alloc& ba) {
     return NULL;
   }
+  read_block(filename, size, offset, extra, last, data);
+  return data;
+}
 
-  if (rank < p - 1) {
-    t.readsome(data, size + extra);
-  } else {
-    t.readsome(data, size);
-    for (uint32_t i = 0; i < extra; i++) {
-      data[size + i] = 0;
+char* file_block_decompose(const char* filename, std::vector<char>& buffer,
+                           uint64_t& size, uint64_t& file_size,
+                           uint64_t& offset, MPI_Comm comm,
+                           uint64_t alignment, uint32_t extra) {
+  const bool last =
+      decompose(filename, size, file_size, offset, comm, alignment);
+  if (buffer.size() < size + extra) {
+    try {
+      buffer.resize(size + extra);
+    } catch (std::bad_alloc& ba) {
+      return NULL;
     }
   }
+  read_block(filename, size, offset, extra, last, &buffer[0]);
+  return &buffer[0];
+}
+
+char* file_block_decompose_reversed(const char* filename, uint64_t& size,
+                                    uint64_t& file_size, uint64_t& offset,
+                                    text_view& view, MPI_Comm comm,
+                                    uint64_t alignment, uint32_t extra) {
+  file_size = get_filesize(filename);
+  int32_t p, rank;
+  MPI_Comm_size(comm, &p);
+  MPI_Comm_rank(comm, &rank);
+  block_range(file_size, p, rank, alignment, offset, size);
+  uint64_t last_offset, last_size;
+  block_range(file_size, p, p - 1, alignment, last_offset, last_size);
+  const uint64_t text_size = last_offset + last_size;
+
+  // Reversed positions [offset, offset + size + extra) are file positions
+  // text_size - 1 - offset down to first, clipped at the start of the file.
+  const uint64_t first = text_size > offset + size + extra
+                             ? text_size - offset - size - extra
+                             : 0;
+  const uint64_t count = text_size > offset ? text_size - offset - first : 0;
+  char* data = new (std::nothrow) char[count + 1];
+  if (data == NULL) {
+    return NULL;
+  }
+  std::ifstream t(filename, std::ifstream::binary);
+  t.seekg(first);
+  t.read(data, count);
+  if (static_cast<uint64_t>(t.gcount()) != count) {
+    delete[] data;
+    return NULL;
+  }
+  view.data = data;
+  view.base = static_cast<int64_t>(count) - 1;
+  view.step = -1;
+  view.limit = text_size > offset ? text_size - offset : 0;
   return data;
 }
 
+int32_t file_write_at(MPI_File fh, uint64_t offset, const char* buf,
+                      uint64_t count) {
+  const uint64_t max_piece = 1 << 30;
+  while (count > 0) {
+    const uint64_t piece = std::min(count, max_piece);
+    if (MPI_File_write_at(fh, static_cast<MPI_Offset>(offset), buf,
+                          static_cast<int>(piece), MPI_BYTE,
+                          MPI_STATUS_IGNORE) != MPI_SUCCESS) {
+      return -1;
+    }
+    offset += piece;
+    buf += piece;
+    count -= piece;
+  }
+  return 0;
+}
+
+int32_t write_distributed_array(const char* filename, const void* data,
+                                uint64_t count, uint64_t elem_size,
+                                uint64_t global_offset, MPI_Comm comm) {
+  uint64_t total = 0;
+  MPI_Allreduce(&count, &total, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, comm);
+
+  MPI_File fh;
+  if (MPI_File_open(comm, const_cast<char*>(filename),
+                    MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL,
+                    &fh) != MPI_SUCCESS) {
+    return -1;
+  }
+  MPI_File_set_size(fh, static_cast<MPI_Offset>(total * elem_size));
+  int32_t status = file_write_at(fh, global_offset * elem_size,
+                                 static_cast<const char*>(data),
+                                 count * elem_size);
+  MPI_File_close(&fh);
+
+  int32_t global = 0;
+  MPI_Allreduce(&status, &global, 1, MPI_INT, MPI_MIN, comm);
+  return global;
+}
+
 // void write_files(const std::string& filename, _Iterator begin, _Iterator end,
 // MPI_Comm comm = MPI_COMM_WORLD)
 // {
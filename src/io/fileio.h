@@ -1,3 +1,6 @@
+#ifndef __FILEIO__
+#define __FILEIO__
+
 #include <mpi.h>
 
 // C++ includes
@@ -7,11 +10,72 @@
 #include <sstream>
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
 #include <stdint.h>
 #include <stdlib.h>
+#include <vector>
+
+// Read-only view of a process's text block: view[i] is the character at
+// offset + i of the text being indexed, and 0 from limit on.
+struct text_view {
+  const char* data;
+  int64_t base;  // index in data of view[0]
+  int64_t step;  // 1, or -1 for the reversed text
+  uint64_t limit;
+
+  char operator[](uint64_t i) const {
+    return i < limit ? data[base + step * static_cast<int64_t>(i)] : 0;
+  }
+};
+
+// View of a block read by file_block_decompose.
+inline text_view forward_view(const char* data) {
+  text_view view = {data, 0, 1, UINT64_MAX};
+  return view;
+}
 
 size_t get_filesize(const char* filename);
+
+// Offset and size of a process's block of the text, as file_block_decompose
+// splits it.
+void block_range(uint64_t file_size, int32_t p, int32_t rank,
+                 uint64_t alignment, uint64_t& offset, uint64_t& size);
+
 char* file_block_decompose(const char* filename, uint64_t& size,
                            uint64_t& file_size, uint64_t& offset,
                            MPI_Comm comm = MPI_COMM_WORLD,
                            uint64_t alignment = 32, uint32_t extra = 2);
+
+// Same, reading into buffer, which only ever grows so that a server can
+// reuse it from one file to the next. Returns the start of buffer, or NULL.
+char* file_block_decompose(const char* filename, std::vector<char>& buffer,
+                           uint64_t& size, uint64_t& file_size,
+                           uint64_t& offset, MPI_Comm comm = MPI_COMM_WORLD,
+                           uint64_t alignment = 32, uint32_t extra = 2);
+
+// Same blocks as file_block_decompose, but of the reversed text. The text
+// that file_block_decompose's blocks cover is reversed in place, so both
+// builds index the same characters. The file range behind this process's
+// reversed block is read as is and view reads it back to front. Returns the
+// new[] buffer behind view, or NULL.
+char* file_block_decompose_reversed(const char* filename, uint64_t& size,
+                                    uint64_t& file_size, uint64_t& offset,
+                                    text_view& view,
+                                    MPI_Comm comm = MPI_COMM_WORLD,
+                                    uint64_t alignment = 32,
+                                    uint32_t extra = 2);
+
+// Writes count bytes at a byte offset of an open MPI file, split into pieces
+// whose counts fit in an int.
+int32_t file_write_at(MPI_File fh, uint64_t offset, const char* buf,
+                      uint64_t count);
+
+// Writes a distributed array of fixed-width elements to one raw binary file.
+// The count elements of this rank start at element global_offset. Suffix
+// arrays and inverse suffix arrays are both stored this way.
+int32_t write_distributed_array(const char* filename, const void* data,
+                                uint64_t count, uint64_t elem_size,
+                                uint64_t global_offset,
+                                MPI_Comm comm = MPI_COMM_WORLD);
+
+#endif
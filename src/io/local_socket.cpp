@@ -0,0 +1,114 @@
+#include "local_socket.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static bool socket_address(const char* path, sockaddr_un& address) {
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(address.sun_path)) {
+    return false;
+  }
+  strcpy(address.sun_path, path);
+  return true;
+}
+
+int local_listen(const char* path) {
+  sockaddr_un address;
+  if (!socket_address(path, address)) {
+    return -1;
+  }
+  const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  unlink(path);
+  if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+      listen(fd, 16) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+int local_accept(int listener) {
+  int fd;
+  do {
+    fd = accept(listener, NULL, NULL);
+  } while (fd < 0 && errno == EINTR);
+  return fd;
+}
+
+int local_connect(const char* path) {
+  sockaddr_un address;
+  if (!socket_address(path, address)) {
+    return -1;
+  }
+  const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) <
+      0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+int32_t send_message(int fd, const std::vector<std::string>& fields) {
+  std::string message;
+  for (size_t i = 0; i < fields.size(); i++) {
+    message += fields[i];
+    message += '\n';
+  }
+  message += '\n';
+  const char* buf = message.data();
+  size_t left = message.size();
+  while (left > 0) {
+    const ssize_t sent = send(fd, buf, left, MSG_NOSIGNAL);
+    if (sent < 0 && errno == EINTR) {
+      continue;
+    }
+    if (sent <= 0) {
+      return -1;
+    }
+    buf += sent;
+    left -= sent;
+  }
+  return 0;
+}
+
+int32_t receive_message(message_reader& reader,
+                        std::vector<std::string>& fields) {
+  fields.clear();
+  size_t start = 0;
+  while (true) {
+    // Fields are taken off the front of pending as their newlines arrive.
+    const size_t end = reader.pending.find('\n', start);
+    if (end != std::string::npos) {
+      if (end == start) {
+        reader.pending.erase(0, end + 1);
+        return 0;
+      }
+      fields.push_back(reader.pending.substr(start, end - start));
+      start = end + 1;
+      continue;
+    }
+    if (reader.pending.size() > MAX_MESSAGE_SIZE) {
+      return -1;
+    }
+    char buf[4096];
+    const ssize_t got = recv(reader.fd, buf, sizeof(buf), 0);
+    if (got < 0 && errno == EINTR) {
+      continue;
+    }
+    if (got <= 0) {
+      return -1;
+    }
+    reader.pending.append(buf, got);
+  }
+}
@@ -0,0 +1,37 @@
+#ifndef __LOCAL_SOCKET__
+#define __LOCAL_SOCKET__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/*
+ * Unix domain stream sockets for the local servers. A message is a list of
+ * fields, each ended by a newline, with an empty line after the last one, so
+ * file paths go through as they are as long as they hold no newline.
+ */
+const uint64_t MAX_MESSAGE_SIZE = 1 << 20;
+
+// Listening socket bound to path, replacing a stale one; -1 on failure.
+int local_listen(const char* path);
+
+// Next connection to a listening socket; -1 on failure.
+int local_accept(int listener);
+
+// Socket connected to the server listening at path; -1 on failure.
+int local_connect(const char* path);
+
+int32_t send_message(int fd, const std::vector<std::string>& fields);
+
+// Bytes read from a socket past the end of the last message.
+struct message_reader {
+  int fd;
+  std::string pending;
+};
+
+// Reads the next message. Returns -1 on a read error, at the end of the
+// stream, or if the message exceeds MAX_MESSAGE_SIZE.
+int32_t receive_message(message_reader& reader,
+                        std::vector<std::string>& fields);
+
+#endif
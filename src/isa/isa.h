@@ -0,0 +1,21 @@
+#ifndef __SA_INVERSE
+#define __SA_INVERSE
+
+#include <mpi.h>
+#include <stdint.h>
+
+namespace isa {
+
+// Computes the inverse suffix array (rank of every text position) from a
+// distributed suffix array. Each rank holds the SA slice with global indices
+// [offset, offset + size), which is also the text block it owns, and receives
+// the ISA entries for that text block in text order. mpi_dtype describes T.
+template <typename T>
+int32_t invert(const T* suffix_array, uint64_t size, uint64_t offset,
+               T* inverse_suffix_array, MPI_Datatype mpi_dtype, int numprocs,
+               MPI_Comm comm = MPI_COMM_WORLD);
+}
+
+#include "isa.hpp"
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef __ISA__
+#define __ISA__
+
+#include <algorithm>
+#include <new>
+#include <mpi.h>
+
+// NOTES:
+// Like samplesort, this assumes per-rank counts fit in an int, because
+// MPI_Alltoallv takes int counts and displacements.
+
+namespace isa {
+
+// (text position, suffix rank) pair sent to the owner of the text position.
+template <typename T>
+struct rank_pair {
+  T position;
+  T rank;
+};
+
+// Rank whose text block contains position. block_begin holds the first text
+// position of every rank.
+template <typename T>
+inline int owner(const uint64_t *block_begin, int numprocs, T position) {
+  return std::upper_bound(block_begin, block_begin + numprocs,
+                          static_cast<uint64_t>(position)) -
+         block_begin - 1;
+}
+
+template <typename T>
+int32_t invert(const T *suffix_array, uint64_t size, uint64_t offset,
+               T *inverse_suffix_array, MPI_Datatype mpi_dtype, int numprocs,
+               MPI_Comm comm) {
+  uint64_t *block_begin = new (std::nothrow) uint64_t[numprocs];
+  int *send_counts = new (std::nothrow) int[numprocs]();
+  int *recv_counts = new (std::nothrow) int[numprocs];
+  int *send_displacements = new (std::nothrow) int[numprocs];
+  int *recv_displacements = new (std::nothrow) int[numprocs];
+  rank_pair<T> *send = new (std::nothrow) rank_pair<T>[size];
+  if (block_begin == NULL || send_counts == NULL || recv_counts == NULL ||
+      send_displacements == NULL || recv_displacements == NULL ||
+      send == NULL) {
+    delete[] block_begin;
+    delete[] send_counts;
+    delete[] recv_counts;
+    delete[] send_displacements;
+    delete[] recv_displacements;
+    delete[] send;
+    return -1;
+  }
+
+  MPI_Allgather(&offset, 1, MPI_UNSIGNED_LONG_LONG, block_begin, 1,
+                MPI_UNSIGNED_LONG_LONG, comm);
+
+  // Bucket (SA[i], offset + i) by the rank owning text position SA[i].
+  for (uint64_t i = 0; i < size; i++) {
+    send_counts[owner(block_begin, numprocs, suffix_array[i])]++;
+  }
+  send_displacements[0] = 0;
+  for (int i = 1; i < numprocs; i++) {
+    send_displacements[i] = send_displacements[i - 1] + send_counts[i - 1];
+  }
+  int *fill = recv_displacements;  // reused as cursor before the exchange
+  std::copy(send_displacements, send_displacements + numprocs, fill);
+  for (uint64_t i = 0; i < size; i++) {
+    rank_pair<T> &p =
+        send[fill[owner(block_begin, numprocs, suffix_array[i])]++];
+    p.position = suffix_array[i];
+    p.rank = static_cast<T>(offset + i);
+  }
+
+  MPI_Alltoall(send_counts, 1, MPI_INT, recv_counts, 1, MPI_INT, comm);
+  recv_displacements[0] = 0;
+  for (int i = 1; i < numprocs; i++) {
+    recv_displacements[i] = recv_displacements[i - 1] + recv_counts[i - 1];
+  }
+
+  // Every text position is ranked exactly once, so a valid suffix array sends
+  // each rank exactly as many pairs as its block holds.
+  const uint64_t recv_size =
+      static_cast<uint64_t>(recv_displacements[numprocs - 1]) +
+      recv_counts[numprocs - 1];
+  rank_pair<T> *recv = new (std::nothrow) rank_pair<T>[recv_size];
+  int32_t status = (recv != NULL && recv_size == size) ? 0 : -1;
+
+  // Agree on failure before the exchange so no rank is left waiting in it.
+  int32_t global_status = 0;
+  MPI_Allreduce(&status, &global_status, 1, MPI_INT, MPI_MIN, comm);
+  if (global_status == 0) {
+    MPI_Datatype mpi_pair;
+    MPI_Type_contiguous(2, mpi_dtype, &mpi_pair);
+    MPI_Type_commit(&mpi_pair);
+    MPI_Alltoallv(send, send_counts, send_displacements, mpi_pair, recv,
+                  recv_counts, recv_displacements, mpi_pair, comm);
+    MPI_Type_free(&mpi_pair);
+  }
+  status = global_status;
+
+  for (uint64_t i = 0; i < recv_size && status == 0; i++) {
+    const uint64_t local = static_cast<uint64_t>(recv[i].position) - offset;
+    if (local >= size) {
+      status = -1;
+    } else {
+      inverse_suffix_array[local] = recv[i].rank;
+    }
+  }
+
+  delete[] block_begin;
+  delete[] send_counts;
+  delete[] recv_counts;
+  delete[] send_displacements;
+  delete[] recv_displacements;
+  delete[] send;
+  delete[] recv;
+  return status;
+}
+
+}  // end namespace
+
+#endif
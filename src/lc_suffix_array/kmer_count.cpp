@@ -0,0 +1,143 @@
+#include "kmer_count.h"
+
+#include <string.h>
+#include <new>
+
+// Ranges at the ends of a node's slice, exchanged to join ranges that
+// cross node boundaries.
+typedef struct kmer_boundary {
+  uint64_t failed;  // the node ran out of memory counting
+  uint64_t num_records;
+  uint64_t first_kmer;
+  uint64_t first_count;
+  uint64_t last_kmer;
+  uint64_t last_count;
+} kmer_boundary;
+
+static int32_t base_code(char c) {
+  switch (c) {
+    case 'A':
+      return 0;
+    case 'C':
+      return 1;
+    case 'G':
+      return 2;
+    case 'T':
+      return 3;
+    default:
+      return -1;
+  }
+}
+
+// Packs the k-mer at text position pos, or returns false if the window
+// runs past the text or holds a character outside ACGT.
+static bool pack_kmer(const char* data, uint64_t file_size, uint64_t pos,
+                      uint32_t k, uint64_t& kmer) {
+  if (pos + k > file_size) {
+    return false;
+  }
+  kmer = 0;
+  for (uint32_t i = 0; i < k; i++) {
+    const int32_t code = base_code(data[pos + i]);
+    if (code < 0) {
+      return false;
+    }
+    kmer = (kmer << 2) | static_cast<uint64_t>(code);
+  }
+  return true;
+}
+
+int32_t count_kmers(const char* data, uint64_t file_size,
+                    const uint64_t* suffix_array, uint64_t size,
+                    uint64_t offset, uint32_t k,
+                    std::vector<kmer_record>& records, MPI_Comm comm) {
+  if (k == 0 || k > KMER_MAX_K) {
+    return -1;
+  }
+  int numprocs, myid;
+  MPI_Comm_size(comm, &numprocs);
+  MPI_Comm_rank(comm, &myid);
+
+  // Every node has to reach the exchange, so failures are agreed on before
+  // it and reported in it rather than returned early.
+  kmer_boundary* all = new (std::nothrow) kmer_boundary[numprocs];
+  int32_t status = all == NULL ? -1 : 0;
+  MPI_Allreduce(MPI_IN_PLACE, &status, 1, MPI_INT, MPI_MIN, comm);
+  if (status < 0) {
+    delete[] all;
+    return -1;
+  }
+
+  kmer_boundary mine;
+  memset(&mine, 0, sizeof(mine));
+  // Skipped suffixes are shorter than k or hold a non-ACGT character
+  // within k, so they never split a range.
+  records.clear();
+  try {
+    for (uint64_t i = 0; i < size; i++) {
+      uint64_t kmer;
+      if (!pack_kmer(data, file_size, suffix_array[i], k, kmer)) {
+        continue;
+      }
+      if (!records.empty() && records.back().kmer == kmer) {
+        records.back().count++;
+      } else {
+        kmer_record r;
+        r.kmer = kmer;
+        r.count = 1;
+        r.sa_begin = offset + i;
+        records.push_back(r);
+      }
+    }
+  } catch (const std::bad_alloc&) {
+    mine.failed = 1;
+  }
+
+  mine.num_records = records.size();
+  if (!records.empty()) {
+    mine.first_kmer = records.front().kmer;
+    mine.first_count = records.front().count;
+    mine.last_kmer = records.back().kmer;
+    mine.last_count = records.back().count;
+  }
+  MPI_Allgather(&mine, sizeof(kmer_boundary), MPI_BYTE, all,
+                sizeof(kmer_boundary), MPI_BYTE, comm);
+  for (int r = 0; r < numprocs; r++) {
+    if (all[r].failed) {
+      records.clear();
+      delete[] all;
+      return -1;
+    }
+  }
+
+  if (!records.empty()) {
+    // The first range belongs to an earlier node if it continues there.
+    bool continued = false;
+    for (int r = myid - 1; r >= 0; r--) {
+      if (all[r].num_records > 0) {
+        continued = (all[r].last_kmer == mine.first_kmer);
+        break;
+      }
+    }
+    // Collect the rest of the last range from the following nodes.
+    if (!continued || records.size() > 1) {
+      for (int r = myid + 1; r < numprocs; r++) {
+        if (all[r].num_records == 0) {
+          continue;
+        }
+        if (all[r].first_kmer != mine.last_kmer) {
+          break;
+        }
+        records.back().count += all[r].first_count;
+        if (all[r].num_records > 1) {
+          break;
+        }
+      }
+    }
+    if (continued) {
+      records.erase(records.begin());
+    }
+  }
+  delete[] all;
+  return 0;
+}
@@ -0,0 +1,35 @@
+#ifndef __KMER_COUNT__
+#define __KMER_COUNT__
+
+#include <stdint.h>
+#include <vector>
+#include "mpi.h"
+
+/*
+ * k-mer counts read off the sorted suffixes. Suffixes that start with the
+ * same k-mer are adjacent in the suffix array, so one pass over a node's
+ * slice yields every k-mer with its count and suffix array range
+ * [sa_begin, sa_begin + count).
+ *
+ * k-mers are DNA over the upper case alphabet ACGT, packed 2 bits per base
+ * with the first base in the most significant used bits, which keeps them
+ * in suffix array order. Windows holding any other character are skipped.
+ */
+const uint32_t KMER_MAX_K = 32;
+
+typedef struct kmer_record {
+  uint64_t kmer;
+  uint64_t count;
+  uint64_t sa_begin;
+} kmer_record;
+
+// Records of the k-mers whose range starts in this node's suffix array
+// slice, which holds global ranks [offset, offset + size). A range that
+// continues on the following nodes is counted in full here and left out
+// there. data holds the whole text of file_size characters.
+int32_t count_kmers(const char* data, uint64_t file_size,
+                    const uint64_t* suffix_array, uint64_t size,
+                    uint64_t offset, uint32_t k,
+                    std::vector<kmer_record>& records, MPI_Comm comm);
+
+#endif
@@ -1,22 +1,50 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <vector>
 #include <fstream>
 #include <streambuf>
 #include <sstream>
 #include <iostream>
 #include "mpi.h"
+#include "../io/fileio.h"
 #include "../lc_suffix_array/suffix_array.h"
+#include "kmer_count.h"
+#include "run_length_bwt.h"
 
 using namespace std;
 
-size_t get_filesize(const char* filename) {
-  std::ifstream in(filename, std::ifstream::ate | std::ifstream::binary);
-  return in.tellg();
-}
-
 int main(int argc, char* argv[]) {
-  if (argc > 2) {
-    fprintf(stdout, "<input file> <output file>\n");
+  // Optional outputs after the input file: a k-mer table with
+  // -k <k> <k-mer output> and a run-length BWT with -r <r-index output>.
+  uint32_t kmer_k = 0;
+  const char* kmer_output = NULL;
+  const char* rindex_output = NULL;
+  for (int i = 2; i < argc;) {
+    int used = 0;
+    if (strcmp(argv[i], "-k") == 0 && i + 2 < argc) {
+      kmer_k = strtoul(argv[i + 1], NULL, 10);
+      kmer_output = argv[i + 2];
+      used = 3;
+    } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+      rindex_output = argv[i + 1];
+      used = 2;
+    } else {
+      i++;
+      continue;
+    }
+    for (int j = i; j + used < argc; j++) {
+      argv[j] = argv[j + used];
+    }
+    argc -= used;
+  }
+  if (argc < 2 || argc > 4 ||
+      (kmer_output != NULL && (kmer_k == 0 || kmer_k > KMER_MAX_K))) {
+    fprintf(stdout,
+            "<input file> [<suffix array output> "
+            "[<inverse suffix array output>]] [-k <k> <k-mer output>] "
+            "[-r <r-index output>]\n");
+    fprintf(stdout, "k is at most %u\n", KMER_MAX_K);
     exit(1);
   }
   int numprocs;
@@ -98,12 +126,22 @@ int main(int argc, char* argv[]) {
     exit(-1);
   }
 
+  uint64_t* inversesuffixarray = NULL;
+  if (argc > 3) {
+    inversesuffixarray = new (std::nothrow) uint64_t[size];
+    if (inversesuffixarray == NULL) {
+      fprintf(stderr, "Bad alloc \n");
+      MPI_Finalize();
+      exit(-1);
+    }
+  }
+
   MPI_Barrier(MPI_COMM_WORLD);  // test only
   double construction_time = MPI::Wtime();
 
   SuffixArray st;
-  if (st.build(data, size, offset, numprocs, rank, suffixarray,
-               MPI_COMM_WORLD) < 0) {
+  if (st.build(data, size, file_size, offset, numprocs, rank, suffixarray,
+               MPI_COMM_WORLD, inversesuffixarray) < 0) {
     fprintf(stderr, "Error in process %d, terminating.\n", rank);
     MPI_Finalize();
     exit(-1);
@@ -120,9 +158,87 @@ int main(int argc, char* argv[]) {
   // }
   // printf("\n");
 
+  // Both arrays are written as raw 64-bit integers in global order.
+  if (argc > 2 &&
+      (write_distributed_array(argv[2], suffixarray, size, sizeof(uint64_t),
+                               offset) < 0 ||
+       (argc > 3 &&
+        write_distributed_array(argv[3], inversesuffixarray, size,
+                                sizeof(uint64_t), offset) < 0))) {
+    if (!rank) fprintf(stderr, "Writing output failed.\n");
+    MPI_Finalize();
+    exit(-1);
+  }
+
+  // k-mer records are written in suffix array order, which is also k-mer
+  // order.
+  if (kmer_output != NULL) {
+    double kmer_time = MPI::Wtime();
+    vector<kmer_record> kmers;
+    uint64_t num_kmers = 0;
+    uint64_t kmer_offset = 0;
+    int32_t status = count_kmers(data, file_size, suffixarray, size, offset,
+                                 kmer_k, kmers, MPI_COMM_WORLD);
+    // The write is collective, so every node skips it if any failed.
+    MPI_Allreduce(MPI_IN_PLACE, &status, 1, MPI_INT, MPI_MIN,
+                  MPI_COMM_WORLD);
+    num_kmers = kmers.size();
+    MPI_Exscan(&num_kmers, &kmer_offset, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM,
+               MPI_COMM_WORLD);
+    if (!rank) kmer_offset = 0;
+    if (status < 0 ||
+        write_distributed_array(kmer_output, kmers.data(), num_kmers,
+                                sizeof(kmer_record), kmer_offset) < 0) {
+      if (!rank) fprintf(stderr, "Writing k-mers failed.\n");
+      MPI_Finalize();
+      exit(-1);
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &num_kmers, 1, MPI_UNSIGNED_LONG_LONG,
+                  MPI_SUM, MPI_COMM_WORLD);
+    if (!rank)
+      fprintf(stdout, "Counted %lu distinct %u-mers in %f\n", num_kmers,
+              kmer_k, MPI::Wtime() - kmer_time);
+  }
+
+  // The runs follow a header record, so every node's runs are written one
+  // record further on.
+  if (rindex_output != NULL) {
+    double rindex_time = MPI::Wtime();
+    vector<rlbwt_run> runs;
+    int32_t status = run_length_bwt(data, file_size, suffixarray, size,
+                                    offset, runs, MPI_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, &status, 1, MPI_INT, MPI_MIN,
+                  MPI_COMM_WORLD);
+    uint64_t num_runs = runs.size();
+    uint64_t run_offset = 0;
+    MPI_Exscan(&num_runs, &run_offset, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM,
+               MPI_COMM_WORLD);
+    if (!rank) run_offset = 0;
+    MPI_Allreduce(MPI_IN_PLACE, &num_runs, 1, MPI_UNSIGNED_LONG_LONG,
+                  MPI_SUM, MPI_COMM_WORLD);
+    if (!rank) {
+      rlbwt_run header = {RLBWT_MAGIC, file_size, num_runs, 0};
+      runs.insert(runs.begin(), header);
+    } else {
+      run_offset++;
+    }
+    if (status < 0 ||
+        write_distributed_array(rindex_output, runs.data(), runs.size(),
+                                sizeof(rlbwt_run), run_offset) < 0) {
+      if (!rank) fprintf(stderr, "Writing the run-length BWT failed.\n");
+      MPI_Finalize();
+      exit(-1);
+    }
+    if (!rank)
+      fprintf(stdout, "Wrote %lu BWT runs (n/r = %.2f) in %f\n", num_runs,
+              num_runs ? static_cast<double>(file_size + 1) / num_runs : 0.0,
+              MPI::Wtime() - rindex_time);
+  }
+
   // Done
   free(data);
   free(suffixarray);
+  delete[] inversesuffixarray;
   MPI_Finalize();
   exit(0);
 }
@@ -0,0 +1,94 @@
+#include "run_length_bwt.h"
+
+#include <string.h>
+#include <new>
+
+// Runs at the ends of a node's rows, exchanged to join runs that cross
+// node boundaries.
+typedef struct rlbwt_boundary {
+  uint64_t num_runs;
+  uint64_t first_head;
+  uint64_t first_last_sa;
+  uint64_t last_head;
+} rlbwt_boundary;
+
+static inline void add_row(std::vector<rlbwt_run>& runs, uint64_t row,
+                           uint64_t head, uint64_t sa) {
+  if (!runs.empty() && runs.back().head == head) {
+    runs.back().last_sa = sa;
+    return;
+  }
+  rlbwt_run r;
+  r.start = row;
+  r.head = head;
+  r.first_sa = sa;
+  r.last_sa = sa;
+  runs.push_back(r);
+}
+
+int32_t run_length_bwt(const char* data, uint64_t file_size,
+                       const uint64_t* suffix_array, uint64_t size,
+                       uint64_t offset, std::vector<rlbwt_run>& runs,
+                       MPI_Comm comm) {
+  int numprocs, myid;
+  MPI_Comm_size(comm, &numprocs);
+  MPI_Comm_rank(comm, &myid);
+
+  runs.clear();
+  if (offset == 0 && file_size > 0) {
+    add_row(runs, 0,
+            static_cast<unsigned char>(data[file_size - 1]), file_size);
+  }
+  for (uint64_t i = 0; i < size; i++) {
+    const uint64_t sa = suffix_array[i];
+    const uint64_t head =
+        sa == 0 ? RLBWT_DOLLAR : static_cast<unsigned char>(data[sa - 1]);
+    add_row(runs, offset + i + 1, head, sa);
+  }
+
+  rlbwt_boundary mine;
+  memset(&mine, 0, sizeof(mine));
+  mine.num_runs = runs.size();
+  if (!runs.empty()) {
+    mine.first_head = runs.front().head;
+    mine.first_last_sa = runs.front().last_sa;
+    mine.last_head = runs.back().head;
+  }
+  rlbwt_boundary* all = new (std::nothrow) rlbwt_boundary[numprocs];
+  if (all == NULL) {
+    return -1;
+  }
+  MPI_Allgather(&mine, sizeof(rlbwt_boundary), MPI_BYTE, all,
+                sizeof(rlbwt_boundary), MPI_BYTE, comm);
+
+  if (!runs.empty()) {
+    // The first run belongs to an earlier node if it continues there.
+    bool continued = false;
+    for (int r = myid - 1; r >= 0; r--) {
+      if (all[r].num_runs > 0) {
+        continued = (all[r].last_head == mine.first_head);
+        break;
+      }
+    }
+    // Find where the last run ends on the following nodes.
+    if (!continued || runs.size() > 1) {
+      for (int r = myid + 1; r < numprocs; r++) {
+        if (all[r].num_runs == 0) {
+          continue;
+        }
+        if (all[r].first_head != mine.last_head) {
+          break;
+        }
+        runs.back().last_sa = all[r].first_last_sa;
+        if (all[r].num_runs > 1) {
+          break;
+        }
+      }
+    }
+    if (continued) {
+      runs.erase(runs.begin());
+    }
+  }
+  delete[] all;
+  return 0;
+}
@@ -0,0 +1,41 @@
+#ifndef __RUN_LENGTH_BWT__
+#define __RUN_LENGTH_BWT__
+
+#include <stdint.h>
+#include <vector>
+#include "mpi.h"
+
+/*
+ * Run-length BWT with the suffix array samples of the r-index (Gagie,
+ * Navarro and Prezza, Optimal-time text indexing in BWT-runs bounded space,
+ * 2018), read off the sorted suffixes in one pass.
+ *
+ * Rows 0..file_size are the sorted suffixes of text$, row 0 being $ alone,
+ * so row i + 1 is suffix array index i. The BWT of row i is the character
+ * before its suffix, RLBWT_DOLLAR for the suffix starting at 0. Each run of
+ * equal BWT characters keeps its first row and the suffix array values at
+ * its first and last rows; nothing else is needed to count and locate.
+ *
+ * Output layout: one header record {RLBWT_MAGIC, file_size, number of runs,
+ * 0}, then one record per run in row order, all u64 in host byte order.
+ */
+const uint64_t RLBWT_MAGIC = 0x3158444e4952ULL;  // "RINDX1"
+const uint64_t RLBWT_DOLLAR = 256;
+
+typedef struct rlbwt_run {
+  uint64_t start;
+  uint64_t head;
+  uint64_t first_sa;
+  uint64_t last_sa;
+} rlbwt_run;
+
+// Runs that start in this node's rows, which are suffix array indices
+// [offset, offset + size) plus row 0 on the node with offset 0. A run that
+// continues on the following nodes is completed here and left out there.
+// data holds the whole text of file_size characters.
+int32_t run_length_bwt(const char* data, uint64_t file_size,
+                       const uint64_t* suffix_array, uint64_t size,
+                       uint64_t offset, std::vector<rlbwt_run>& runs,
+                       MPI_Comm comm);
+
+#endif
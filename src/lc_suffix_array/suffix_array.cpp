@@ -1,28 +1,35 @@
 #include "suffix_array.h"
 #include "../sort/ssort.h"
 #include "../sais/sais.h"
+#include "../isa/isa.h"
+#include "../simd/mismatch.h"
 
 /*
  * My SSM algorithm.
  */
 
+// Orders suffixes whose first 8 characters are equal. _size is the text
+// size; the zero padding after the text lets the tail compare whole words.
 struct compare_radix_css_elem : std::binary_function<css_elem, css_elem, bool> {
   compare_radix_css_elem(const char* data, const uint64_t size)
-      : _data(data), _size(size) {}
+      : _data(reinterpret_cast<const unsigned char*>(data)), _size(size) {}
   bool operator()(const css_elem& lhs, const css_elem& rhs) {
     uint64_t lindex = lhs.index;
     uint64_t rindex = rhs.index;
 
-    uint64_t length = _size - std::max(lindex, rindex) - 8;
-
-    for (uint64_t i = 0; i < length; i++) {
-      if (_data[i + 8 + lindex] != _data[i + 8 + rindex]) {
+    uint64_t start = std::max(lindex, rindex) + 8;
+    if (start < _size) {
+      uint64_t length = _size - start;
+      uint64_t i = mismatch_padded(_data + lindex + 8, _data + rindex + 8,
+                                   length);
+      if (i < length) {
         return _data[i + 8 + lindex] < _data[i + 8 + rindex];
       }
     }
-    return lindex < rindex;
+    // One is a prefix of the other: the shorter suffix comes first.
+    return lindex > rindex;
   }
-  const char* _data;
+  const unsigned char* _data;
   const uint64_t _size;
 };
 
@@ -43,8 +50,10 @@ SuffixArray::SuffixArray() {
 };
 
 int32_t SuffixArray::build(const char* data, uint32_t size,
-                           uint64_t offset, int numprocs, int myid,
-                           uint64_t* suffix_array, MPI_Comm comm) {
+                           uint64_t file_size, uint64_t offset,
+                           int numprocs, int myid,
+                           uint64_t* suffix_array, MPI_Comm comm,
+                           uint64_t* inverse_suffix_array) {
   MPI_Comm_size(comm, &numprocs);
   MPI_Comm_rank(comm, &myid);
   // If N is small, switch to single thread.
@@ -75,14 +84,14 @@ int32_t SuffixArray::build(const char* data, uint32_t size,
   // S stores: [data[pos, pos+7], index].
   uint64_t word = 0;
   for (int i = 0; i < 7; i++) {
-    uint64_t elem = static_cast<uint64_t>(node_data[i]);
+    uint64_t elem = static_cast<unsigned char>(node_data[i]);
     word = (word << 8) + elem;
   }
   for (uint64_t pos = 0; pos < size; pos++) {
     // Watch unsigned / signed
     // Read 8 chars
 
-    uint64_t elem = static_cast<uint64_t>(node_data[pos + 7]);
+    uint64_t elem = static_cast<unsigned char>(node_data[pos + 7]);
     word = (word << 8) + elem;
     S[pos].word = word;
     S[pos].index = pos + offset;
@@ -181,7 +190,7 @@ int32_t SuffixArray::build(const char* data, uint32_t size,
             // naive comparator
             uint64_t local_size = j - start_pos + 1;
             std::sort(S + start_pos, S + start_pos + local_size,
-                      compare_radix_css_elem(data, size));
+                      compare_radix_css_elem(data, file_size));
 
             is_seq = false;
             start_pos = -1;
@@ -202,7 +211,7 @@ int32_t SuffixArray::build(const char* data, uint32_t size,
           pos_start--;
         }
         std::sort(S + pos_start, S + pos_end + 1,
-                  compare_radix_css_elem(data, size));
+                  compare_radix_css_elem(data, file_size));
       }
     }
   }
@@ -222,6 +231,14 @@ int32_t SuffixArray::build(const char* data, uint32_t size,
     suffix_array[i] = S[i].index;
   }
 
+  // The SA slice covers global ranks [offset, offset + size), so ranks can be
+  // sent straight to the owners of the text positions.
+  if (inverse_suffix_array != NULL &&
+      isa::invert(suffix_array, size, offset, inverse_suffix_array,
+                  MPI_UNSIGNED_LONG_LONG, numprocs, comm) < 0) {
+    return -1;
+  }
+
   MPI_Barrier(comm);
   if (!myid) {
     fprintf(stdout, "Runtime of component 4: %f\n\n", MPI::Wtime() - elapsed);
@@ -13,8 +13,13 @@ typedef struct css_elem {
 class SuffixArray {
  public:
   SuffixArray();
-  int32_t build(const char* data, uint32_t size, uint64_t offset, int numprocs,
-                int myid, uint64_t* suffix_array, MPI_Comm comm);
+  // data holds the whole text of file_size characters followed by at least
+  // 7 zero bytes. If inverse_suffix_array is given, it receives the ranks of
+  // the suffixes starting in this node's text block, in text order.
+  int32_t build(const char* data, uint32_t size, uint64_t file_size,
+                uint64_t offset, int numprocs, int myid,
+                uint64_t* suffix_array, MPI_Comm comm,
+                uint64_t* inverse_suffix_array = NULL);
 
  private:
   MPI_Datatype mpi_css_elem;
@@ -22,4 +27,4 @@ class SuffixArray {
   const char* _data;
 };
 
-#endif
\ No newline at end of file
+#endif
\ No newline at end of file
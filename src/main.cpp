@@ -1,40 +1,115 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string>
+#include <vector>
+#include <time.h>
+#include <unistd.h>
 #include "mpi.h"
 #include "io/fileio.h"
+#include "io/local_socket.h"
 #include "suffix_array/suffix_array.h"
+#include "suffix_array/distributed_bwt.h"
 
 using namespace std;
 
-int main(int argc, char* argv[]) {
-  int numprocs;
-  int myid;
-  int namelen;
-  char processor_name[MPI_MAX_PROCESSOR_NAME];
+const char* USAGE =
+    "[-b <bwt output> <reverse bwt output>] <input file> "
+    "[<suffix array output> [<inverse suffix array output>]]\n"
+    "  or -s <socket> to serve builds, -c <socket> <arguments | quit> to "
+    "request one\n"
+    "  or -q <jobs> to run the builds listed one per line concurrently\n";
 
-  MPI_Init(&argc, &argv);
-  MPI_Comm_size(MPI_COMM_WORLD, &numprocs);
-  MPI_Comm_rank(MPI_COMM_WORLD, &myid);
-  MPI_Get_processor_name(processor_name, &namelen);
+// In batch mode an input gets one process per BATCH_BYTES_PER_RANK bytes,
+// at least one and at most all the workers.
+const uint64_t BATCH_BYTES_PER_RANK = 16 << 20;
+const int BATCH_TAG_READY = 1;
+const int BATCH_TAG_JOB = 2;
 
-  // fprintf(stdout, "Process %d on %s\n", myid, processor_name);
+// One build, as given on the command line.
+struct build_job {
+  const char* input;
+  const char* sa_output;
+  const char* isa_output;
+  // -b <forward> <reverse> also writes the BWTs of the text and of the
+  // reversed text, for a bidirectional index.
+  const char* bwt_output;
+  const char* reverse_bwt_output;
+};
+
+// Buffers kept from one build to the next by a server. They only grow.
+struct build_arena {
+  std::vector<char> data;
+  std::vector<uint32_t> suffix_array;
+  std::vector<uint32_t> inverse_suffix_array;
+};
+
+int32_t parse_job(int argc, char* argv[], build_job& job) {
+  job.bwt_output = NULL;
+  job.reverse_bwt_output = NULL;
+  if (argc > 2 && std::string(argv[0]) == "-b") {
+    job.bwt_output = argv[1];
+    job.reverse_bwt_output = argv[2];
+    argv += 3;
+    argc -= 3;
+  }
+  if (argc < 1 || argc > 3) {
+    return -1;
+  }
+  job.input = argv[0];
+  job.sa_output = argc > 1 ? argv[1] : NULL;
+  job.isa_output = argc > 2 ? argv[2] : NULL;
+  return 0;
+}
+
+// Same, from fields that outlive job.
+int32_t parse_job(std::vector<std::string>& fields, build_job& job) {
+  std::vector<char*> args;
+  for (size_t i = 0; i < fields.size(); i++) {
+    args.push_back(&fields[i][0]);
+  }
+  return parse_job(args.size(), args.data(), job);
+}
+
+int32_t all_ok(int32_t status, MPI_Comm comm = MPI_COMM_WORLD) {
+  int32_t global = 0;
+  MPI_Allreduce(&status, &global, 1, MPI_INT, MPI_MIN, comm);
+  return global;
+}
+
+// Computes this process's part of the BWT of the block behind data and
+// writes it, all processes together.
+int32_t write_bwt(const char* filename, const text_view& data, uint64_t size,
+                  uint64_t offset, const uint32_t* inverse_suffix_array,
+                  MPI_Comm comm) {
+  std::vector<char> out;
+  uint64_t out_offset = 0;
+  int32_t status = distributed_bwt(data, size, offset, inverse_suffix_array,
+                                   out, out_offset, comm);
+  if (all_ok(status, comm) < 0) {
+    return -1;
+  }
+  return write_distributed_array(filename, out.data(), out.size(), 1,
+                                 out_offset, comm);
+}
+
+// Runs one build on all processes of comm. Returns -1 on every process if
+// it failed on any.
+int32_t run_build(const build_job& job, SuffixArray& st, build_arena& arena,
+                  int numprocs, int myid, MPI_Comm comm = MPI_COMM_WORLD) {
+  int32_t status = 0;
   if (myid == 0) {
-    fprintf(stdout, "There are %d total processors.\n", numprocs);
-    ifstream f(argv[1]);
+    ifstream f(job.input);
     if (!f.good()) {
-      f.close();
       fprintf(stdout, "File doesn't exist\n");
-      MPI_Finalize();
-      exit(-1);
-    } else {
-      f.close();
+      status = -1;
     }
   }
+  if (all_ok(status, comm) < 0) {
+    return -1;
+  }
 
   if(!myid) fprintf(stdout, "Starting suffix array construction\n");
 
-  MPI_Barrier(MPI_COMM_WORLD);  // test only
-
   // Decompose file
   uint64_t size = 0;
   uint64_t file_size = 0;
@@ -43,16 +118,33 @@ int main(int argc, char* argv[]) {
   // Read chunk from file.
   // IMPORTANT: this reads size + 2 characters to remove communication.
   // Hacky ... be careful with data
-  char* data =
-      file_block_decompose(argv[1], size, file_size, offset, MPI_COMM_WORLD, 1);
+  char* data = file_block_decompose(job.input, arena.data, size, file_size,
+                                    offset, comm, 1);
   if (data == NULL) {
     fprintf(stdout, "File allocation on processor %d failed.\n", myid);
-    MPI_Finalize();
-    exit(-1);
+    status = -1;
+  } else {
+    try {
+      if (arena.suffix_array.size() < size) {
+        arena.suffix_array.resize(size);
+      }
+      if ((job.isa_output != NULL || job.bwt_output != NULL) &&
+          arena.inverse_suffix_array.size() < size) {
+        arena.inverse_suffix_array.resize(size);
+      }
+    } catch (std::bad_alloc& ba) {
+      fprintf(stderr, "Bad alloc \n");
+      status = -1;
+    }
   }
-  //fprintf(stdout, "%d: %.*s\n", myid, static_cast<uint32_t>(size), data);
-
-  MPI_Barrier(MPI_COMM_WORLD);  // test only
+  if (all_ok(status, comm) < 0) {
+    return -1;
+  }
+  uint32_t* suffixarray = arena.suffix_array.data();
+  uint32_t* inversesuffixarray =
+      job.isa_output != NULL || job.bwt_output != NULL
+          ? arena.inverse_suffix_array.data()
+          : NULL;
 
   /*
    *  Begin construction!
@@ -60,42 +152,390 @@ int main(int argc, char* argv[]) {
 
   if(!myid) fprintf(stdout,"Begin suffix array construction\n");
 
-  uint32_t* suffixarray = NULL;
-  try {
-    suffixarray = new uint32_t[size]();
-  } catch (std::bad_alloc& ba) {
-    fprintf(stderr, "Bad alloc \n");
-    MPI_Finalize();
-    exit(-1);
-  }
-
-  MPI_Barrier(MPI_COMM_WORLD);  // test only
+  MPI_Barrier(comm);  // test only
   double construction_time = MPI::Wtime();
 
-  SuffixArray st;
-  if (st.build(data, size, file_size, offset, numprocs, myid, suffixarray) <
-      0) {
-    fprintf(stderr, "Error in process %d, terminating.\n", myid);
-    MPI_Finalize();
-    exit(-1);
+  status = st.build(data, size, file_size, offset, numprocs, myid,
+                    suffixarray, inversesuffixarray, comm);
+  if (status < 0) {
+    fprintf(stderr, "Error in process %d.\n", myid);
+  }
+  if (all_ok(status, comm) < 0) {
+    return -1;
   }
 
   // fprintf(stdout, "Done building at rank %d\n", myid);
-  MPI_Barrier(MPI_COMM_WORLD);
   if(!myid)
     fprintf(stdout, "Building time: %f\n", MPI::Wtime() - construction_time);
 
-  /*
-  printf("Result: %d: ", myid);
-  for(uint64_t i = 0; i < size; i++) {
-    printf("%u ", suffixarray[i]);
+  // Both arrays are written as raw 32-bit integers in global order.
+  if ((job.sa_output != NULL &&
+       write_distributed_array(job.sa_output, suffixarray, size,
+                               sizeof(uint32_t), offset, comm) < 0) ||
+      (job.isa_output != NULL &&
+       write_distributed_array(job.isa_output, inversesuffixarray, size,
+                               sizeof(uint32_t), offset, comm) < 0)) {
+    if (!myid) fprintf(stderr, "Writing output failed.\n");
+    return -1;
+  }
+
+  // The BWT comes from the inverse suffix array. The reversed text is then
+  // built the same way into the same arrays, read through a reversed view
+  // of the mirrored file range instead of a reversed copy.
+  if (job.bwt_output != NULL) {
+    double bwt_time = MPI::Wtime();
+    if (write_bwt(job.bwt_output, forward_view(data), size, offset,
+                  inversesuffixarray, comm) < 0) {
+      if (!myid) fprintf(stderr, "Writing BWT failed.\n");
+      return -1;
+    }
+    text_view view;
+    char* reversed = file_block_decompose_reversed(
+        job.input, size, file_size, offset, view, comm, 1);
+    if (all_ok(reversed == NULL ? -1 : 0, comm) < 0 ||
+        all_ok(st.build(view, size, file_size, offset, numprocs, myid,
+                        suffixarray, inversesuffixarray, comm),
+               comm) < 0 ||
+        write_bwt(job.reverse_bwt_output, view, size, offset,
+                  inversesuffixarray, comm) < 0) {
+      if (!myid) fprintf(stderr, "Reverse BWT failed.\n");
+      delete[] reversed;
+      return -1;
+    }
+    delete[] reversed;
+    if (!myid)
+      fprintf(stdout, "BWT time: %f\n", MPI::Wtime() - bwt_time);
+  }
+  return 0;
+}
+
+// Broadcasts the fields of a request from process 0. The others wait in a
+// polling loop rather than in MPI_Bcast, which would spin on their cores for
+// as long as the server is idle.
+void broadcast_fields(std::vector<std::string>& fields, int myid) {
+  std::string joined;
+  for (size_t i = 0; i < fields.size(); i++) {
+    joined += fields[i];
+    joined += '\n';
+  }
+  uint64_t length = joined.size();
+  MPI_Request request;
+  MPI_Ibcast(&length, 1, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD, &request);
+  int done = 0;
+  MPI_Test(&request, &done, MPI_STATUS_IGNORE);
+  while (!done) {
+    const timespec pause = {0, 1000000};
+    nanosleep(&pause, NULL);
+    MPI_Test(&request, &done, MPI_STATUS_IGNORE);
+  }
+  joined.resize(length);
+  MPI_Bcast(&joined[0], static_cast<int>(length), MPI_CHAR, 0,
+            MPI_COMM_WORLD);
+  if (myid != 0) {
+    fields.clear();
+    size_t start = 0;
+    for (size_t i = 0; i < joined.size(); i++) {
+      if (joined[i] == '\n') {
+        fields.push_back(joined.substr(start, i - start));
+        start = i + 1;
+      }
+    }
+  }
+}
+
+// Serves build requests from a local socket, one at a time, until one says
+// quit. A request holds the command line arguments of a build; the reply is
+// "ok" and the build time, or "error". The processes, the datatypes of st
+// and the arena are kept from one build to the next.
+int32_t serve(const char* socket_path, int numprocs, int myid) {
+  int listener = -1;
+  if (myid == 0) {
+    listener = local_listen(socket_path);
+    if (listener < 0) {
+      fprintf(stderr, "Failed to listen on %s\n", socket_path);
+    } else {
+      fprintf(stdout, "Serving builds on %s\n", socket_path);
+    }
+  }
+  if (all_ok(listener < 0 && myid == 0 ? -1 : 0) < 0) {
+    return -1;
+  }
+  fflush(stdout);
+
+  SuffixArray st;
+  build_arena arena;
+  while (true) {
+    std::vector<std::string> fields;
+    int connection = -1;
+    if (myid == 0) {
+      message_reader reader = {-1, ""};
+      while (connection < 0) {
+        connection = local_accept(listener);
+        reader.fd = connection;
+        if (connection >= 0 && receive_message(reader, fields) < 0) {
+          close(connection);
+          connection = -1;
+        }
+      }
+    }
+    broadcast_fields(fields, myid);
+    if (fields.size() == 1 && fields[0] == "quit") {
+      if (myid == 0) {
+        send_message(connection, std::vector<std::string>(1, "ok"));
+        close(connection);
+      }
+      break;
+    }
+
+    build_job job;
+    int32_t status = -1;
+    double elapsed = MPI::Wtime();
+    if (parse_job(fields, job) == 0) {
+      status = run_build(job, st, arena, numprocs, myid);
+    } else if (myid == 0) {
+      fprintf(stderr, "Bad request\n");
+    }
+    elapsed = MPI::Wtime() - elapsed;
+    if (myid == 0) {
+      std::vector<std::string> reply(1, status == 0 ? "ok" : "error");
+      if (status == 0) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%f", elapsed);
+        reply.push_back(buf);
+      }
+      send_message(connection, reply);
+      close(connection);
+    }
+    fflush(stdout);
+  }
+  if (myid == 0) {
+    close(listener);
+    unlink(socket_path);
+  }
+  return 0;
+}
+
+// Splits a line of a jobs file into its arguments.
+std::vector<std::string> split_arguments(const std::string& line) {
+  std::vector<std::string> args;
+  std::istringstream in(line);
+  std::string arg;
+  while (in >> arg) {
+    args.push_back(arg);
+  }
+  return args;
+}
+
+// Hands out the inputs of a batch, largest first, to groups of idle workers
+// sized to each input, and reports them as they finish. Workers ask for
+// work with {job, status} of their last job, {-1, 0} at first.
+int32_t schedule_batch(const std::vector<std::string>& lines, int numprocs) {
+  const int workers = numprocs - 1;
+  const int count = lines.size();
+  std::vector<uint64_t> sizes(count, 0);
+  std::vector<int> group_sizes(count), order(count);
+  for (int j = 0; j < count; j++) {
+    build_job job;
+    std::vector<std::string> fields = split_arguments(lines[j]);
+    if (parse_job(fields, job) == 0) {
+      ifstream f(job.input);
+      if (f.good()) {
+        sizes[j] = get_filesize(job.input);
+      }
+    }
+    const uint64_t ranks =
+        (sizes[j] + BATCH_BYTES_PER_RANK - 1) / BATCH_BYTES_PER_RANK;
+    group_sizes[j] = static_cast<int>(
+        std::max<uint64_t>(1, std::min<uint64_t>(ranks, workers)));
+    order[j] = j;
+  }
+  std::sort(order.begin(), order.end(),
+            [&](int a, int b) { return sizes[a] > sizes[b]; });
+
+  std::vector<int> idle, reports(count, 0);
+  std::vector<double> started(count, 0);
+  int next = 0, finished = 0, failed = 0;
+  const double batch_time = MPI::Wtime();
+  while (finished < count) {
+    int message[2];
+    MPI_Status status;
+    MPI_Recv(message, 2, MPI_INT, MPI_ANY_SOURCE, BATCH_TAG_READY,
+             MPI_COMM_WORLD, &status);
+    const int j = message[0];
+    if (j >= 0 && ++reports[j] == group_sizes[j]) {
+      finished++;
+      failed += message[1] < 0;
+      fprintf(stdout, "Input %d (%s) on %d processes: %s, %f s\n", j,
+              lines[j].c_str(), group_sizes[j],
+              message[1] < 0 ? "error" : "ok", MPI::Wtime() - started[j]);
+      fflush(stdout);
+    }
+    idle.push_back(status.MPI_SOURCE);
+    while (next < count && static_cast<int>(idle.size()) >=
+                               group_sizes[order[next]]) {
+      const int job = order[next++];
+      const int g = group_sizes[job];
+      std::vector<int> assignment(2 + g);
+      assignment[0] = job;
+      assignment[1] = g;
+      std::copy(idle.end() - g, idle.end(), assignment.begin() + 2);
+      idle.resize(idle.size() - g);
+      std::sort(assignment.begin() + 2, assignment.end());
+      started[job] = MPI::Wtime();
+      for (int k = 0; k < g; k++) {
+        MPI_Send(&assignment[0], 2 + g, MPI_INT, assignment[2 + k],
+                 BATCH_TAG_JOB, MPI_COMM_WORLD);
+      }
+    }
+  }
+  const int stop = -1;
+  for (int w = 1; w <= workers; w++) {
+    MPI_Send(&stop, 1, MPI_INT, w, BATCH_TAG_JOB, MPI_COMM_WORLD);
+  }
+  fprintf(stdout, "Batch of %d inputs on %d workers: %d failed, %f s\n", count,
+          workers, failed, MPI::Wtime() - batch_time);
+  return failed ? -1 : 0;
+}
+
+// Runs the inputs assigned by process 0, each on a communicator created
+// for its group only, so other groups keep building meanwhile.
+void work_batch(const std::vector<std::string>& lines, int numprocs) {
+  SuffixArray st;
+  build_arena arena;
+  MPI_Group world_group;
+  MPI_Comm_group(MPI_COMM_WORLD, &world_group);
+  int message[2] = {-1, 0};
+  std::vector<int> assignment(numprocs + 2);
+  while (true) {
+    MPI_Send(message, 2, MPI_INT, 0, BATCH_TAG_READY, MPI_COMM_WORLD);
+    MPI_Recv(&assignment[0], numprocs + 2, MPI_INT, 0, BATCH_TAG_JOB,
+             MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    const int j = assignment[0];
+    if (j < 0) {
+      break;
+    }
+    MPI_Group group;
+    MPI_Comm comm;
+    MPI_Group_incl(world_group, assignment[1], &assignment[2], &group);
+    MPI_Comm_create_group(MPI_COMM_WORLD, group, j, &comm);
+    int group_procs, group_id;
+    MPI_Comm_size(comm, &group_procs);
+    MPI_Comm_rank(comm, &group_id);
+
+    build_job job;
+    std::vector<std::string> fields = split_arguments(lines[j]);
+    message[0] = j;
+    message[1] = parse_job(fields, job) == 0
+                     ? run_build(job, st, arena, group_procs, group_id, comm)
+                     : -1;
+    MPI_Comm_free(&comm);
+    MPI_Group_free(&group);
+  }
+  MPI_Group_free(&world_group);
+}
+
+// Runs every build listed in a jobs file, one per line with the arguments
+// of the command line. Process 0 schedules; with no other process, it runs
+// them itself one after another.
+int32_t run_batch(const char* jobs_file, int numprocs, int myid) {
+  std::vector<std::string> lines;
+  if (myid == 0) {
+    ifstream in(jobs_file);
+    std::string line;
+    while (std::getline(in, line)) {
+      const std::vector<std::string> args = split_arguments(line);
+      if (!args.empty() && args[0][0] != '#') {
+        lines.push_back(line);
+      }
+    }
+    fprintf(stdout, "%zu inputs in %s\n", lines.size(), jobs_file);
+  }
+  broadcast_fields(lines, myid);
+
+  if (numprocs == 1) {
+    SuffixArray st;
+    build_arena arena;
+    int32_t status = 0;
+    for (size_t j = 0; j < lines.size(); j++) {
+      build_job job;
+      std::vector<std::string> fields = split_arguments(lines[j]);
+      if (parse_job(fields, job) < 0 ||
+          run_build(job, st, arena, 1, 0) < 0) {
+        fprintf(stdout, "Input %zu (%s): error\n", j, lines[j].c_str());
+        status = -1;
+      }
+    }
+    return status;
+  }
+  if (myid == 0) {
+    return schedule_batch(lines, numprocs);
+  }
+  work_batch(lines, numprocs);
+  return 0;
+}
+
+// Sends one request to a server and prints the reply. No MPI here.
+int request(const char* socket_path, int argc, char* argv[]) {
+  const int fd = local_connect(socket_path);
+  if (fd < 0) {
+    fprintf(stderr, "Failed to connect to %s\n", socket_path);
+    return 1;
+  }
+  std::vector<std::string> fields(argv, argv + argc);
+  std::vector<std::string> reply;
+  message_reader reader = {fd, ""};
+  if (send_message(fd, fields) < 0 || receive_message(reader, reply) < 0) {
+    fprintf(stderr, "No reply from %s\n", socket_path);
+    close(fd);
+    return 1;
+  }
+  close(fd);
+  for (size_t i = 0; i < reply.size(); i++) {
+    fprintf(stdout, "%s%s", i ? " " : "", reply[i].c_str());
+  }
+  fprintf(stdout, "\n");
+  return !reply.empty() && reply[0] == "ok" ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc > 3 && std::string(argv[1]) == "-c") {
+    return request(argv[2], argc - 3, argv + 3);
+  }
+  const bool server = argc == 3 && std::string(argv[1]) == "-s";
+  const bool batch = argc == 3 && std::string(argv[1]) == "-q";
+  build_job job;
+  if (!server && !batch && parse_job(argc - 1, argv + 1, job) < 0) {
+    fprintf(stdout, "%s", USAGE);
+    exit(1);
+  }
+  int numprocs;
+  int myid;
+  int namelen;
+  char processor_name[MPI_MAX_PROCESSOR_NAME];
+
+  MPI_Init(&argc, &argv);
+  MPI_Comm_size(MPI_COMM_WORLD, &numprocs);
+  MPI_Comm_rank(MPI_COMM_WORLD, &myid);
+  MPI_Get_processor_name(processor_name, &namelen);
+
+  // fprintf(stdout, "Process %d on %s\n", myid, processor_name);
+  if (myid == 0) {
+    fprintf(stdout, "There are %d total processors.\n", numprocs);
+  }
+
+  int32_t status;
+  if (server) {
+    status = serve(argv[2], numprocs, myid);
+  } else if (batch) {
+    status = run_batch(argv[2], numprocs, myid);
+    status = all_ok(status);
+  } else {
+    SuffixArray st;
+    build_arena arena;
+    status = run_build(job, st, arena, numprocs, myid);
   }
-  printf("\n");
-  */
 
   // Done
-  free(data);
-  free(suffixarray);
   MPI_Finalize();
-  exit(0);
+  exit(status < 0 ? -1 : 0);
 }
@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include "mpi.h"
+#include "../io/fileio.h"
+#include "../search/index.h"
+#include "smem.h"
+
+using namespace std;
+
+const uint32_t DEFAULT_MIN_LENGTH = 19;
+
+// Reads FASTA, FASTQ or one query per line.
+static int32_t read_queries(const char* filename, vector<string>& names,
+                            vector<string>& seqs) {
+  vector<string> lines;
+  if (read_lines(filename, lines) < 0) {
+    return -1;
+  }
+
+  for (size_t i = 0; i < lines.size(); i++) {
+    const string& line = lines[i];
+    if (line.empty()) {
+      continue;
+    }
+    if (line[0] == '>') {
+      names.push_back(line.substr(1));
+      seqs.push_back(string());
+      while (i + 1 < lines.size() && !lines[i + 1].empty() &&
+             lines[i + 1][0] != '>') {
+        seqs.back() += lines[++i];
+      }
+    } else if (line[0] == '@' && i + 3 < lines.size()) {
+      names.push_back(line.substr(1));
+      seqs.push_back(lines[i + 1]);
+      i += 3;
+    } else {
+      char name[32];
+      snprintf(name, sizeof(name), "%zu", seqs.size());
+      names.push_back(name);
+      seqs.push_back(line);
+    }
+  }
+  return 0;
+}
+
+template <typename T>
+static void find_and_format(const TextIndex& index,
+                            const vector<string>& names,
+                            const vector<string>& seqs, uint32_t min_length,
+                            string& out) {
+  const T* suffix_array = static_cast<const T*>(index.suffix_array);
+  vector<vector<smem::mem_hit> > hits;
+  smem::find_smems(index.text, index.size, suffix_array, seqs, min_length,
+                   hits);
+
+  char buf[64];
+  for (size_t q = 0; q < hits.size(); q++) {
+    for (size_t h = 0; h < hits[q].size(); h++) {
+      const smem::mem_hit& hit = hits[q][h];
+      out += names[q];
+      snprintf(buf, sizeof(buf), "\t%u\t%u\t%lu\t", hit.begin, hit.length,
+               hit.sa_end - hit.sa_begin);
+      out += buf;
+      const uint64_t listed =
+          std::min(hit.sa_end, hit.sa_begin + MAX_LISTED_OCC);
+      for (uint64_t i = hit.sa_begin; i < listed; i++) {
+        snprintf(buf, sizeof(buf), i > hit.sa_begin ? ",%lu" : "%lu",
+                 static_cast<uint64_t>(suffix_array[i]));
+        out += buf;
+      }
+      out += '\n';
+    }
+  }
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 5 || argc > 6) {
+    fprintf(stdout,
+            "<text file> <suffix array> <queries> <output file> "
+            "[min length]\n");
+    exit(1);
+  }
+  int numprocs;
+  int rank;
+
+  MPI_Init(&argc, &argv);
+  MPI_Comm_size(MPI_COMM_WORLD, &numprocs);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+  uint32_t min_length = DEFAULT_MIN_LENGTH;
+  if (argc == 6) {
+    min_length = strtoul(argv[5], NULL, 10);
+  }
+
+  // Every node holds the whole index and takes a contiguous share of the
+  // queries.
+  TextIndex index;
+  vector<string> names, seqs;
+  int32_t status = 0;
+  if (load_index(argv[1], argv[2], index) < 0 ||
+      read_queries(argv[3], names, seqs) < 0) {
+    status = -1;
+  }
+  int32_t global = 0;
+  MPI_Allreduce(&status, &global, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+  if (global < 0) {
+    if (!rank) fprintf(stderr, "Failed to load the index or the queries.\n");
+    MPI_Finalize();
+    exit(-1);
+  }
+  if (!rank) {
+    fprintf(stdout, "Index of %lu characters, %zu queries, %d nodes\n",
+            index.size, seqs.size(), numprocs);
+  }
+
+  const uint64_t p = static_cast<uint64_t>(numprocs);
+  const uint64_t first = seqs.size() * rank / p;
+  const uint64_t last = seqs.size() * (rank + 1) / p;
+  vector<string> local_names(names.begin() + first, names.begin() + last);
+  vector<string> local_seqs(seqs.begin() + first, seqs.begin() + last);
+
+  MPI_Barrier(MPI_COMM_WORLD);
+  double search_time = MPI::Wtime();
+  string out;
+  if (index.width == 4) {
+    find_and_format<uint32_t>(index, local_names, local_seqs, min_length,
+                              out);
+  } else {
+    find_and_format<uint64_t>(index, local_names, local_seqs, min_length,
+                              out);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  search_time = MPI::Wtime() - search_time;
+  if (!rank) {
+    fprintf(stdout, "Search time: %f (%.0f queries per second)\n",
+            search_time, search_time > 0 ? seqs.size() / search_time : 0.0);
+  }
+
+  uint64_t out_size = out.size();
+  uint64_t out_offset = 0;
+  MPI_Exscan(&out_size, &out_offset, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM,
+             MPI_COMM_WORLD);
+  if (!rank) out_offset = 0;
+  if (write_distributed_array(argv[4], out.data(), out_size, 1, out_offset) <
+      0) {
+    if (!rank) fprintf(stderr, "Writing %s failed.\n", argv[4]);
+    MPI_Finalize();
+    exit(-1);
+  }
+
+  free_index(index);
+  MPI_Finalize();
+  exit(0);
+}
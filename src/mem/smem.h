@@ -0,0 +1,39 @@
+#ifndef __SMEM
+#define __SMEM
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace smem {
+
+// Query interval [begin, begin + length) occurs at suffix array indices
+// [sa_begin, sa_end).
+struct mem_hit {
+  uint32_t begin;
+  uint32_t length;
+  uint64_t sa_begin;
+  uint64_t sa_end;
+};
+
+// Binary searches each thread advances in lockstep, so that their memory
+// accesses overlap.
+const uint32_t SMEM_INTERLEAVE = 16;
+// Queries handed to a thread at a time.
+const uint32_t SMEM_CHUNK = 64;
+
+// Finds the supermaximal exact matches (SMEMs) of every query: matches of
+// at least min_length characters that are not contained in a longer match
+// of the same query. They are read off the matching statistics, the
+// longest match starting at every query position, which are computed with
+// one suffix array search per position. hits[q] lists the SMEMs of query q
+// from left to right.
+template <typename T>
+void find_smems(const unsigned char* text, uint64_t size,
+                const T* suffix_array, const std::vector<std::string>& queries,
+                uint32_t min_length, std::vector<std::vector<mem_hit> >& hits);
+}
+
+#include "smem.hpp"
+
+#endif
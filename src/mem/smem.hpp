@@ -0,0 +1,118 @@
+#ifndef __SMEM_IMPL__
+#define __SMEM_IMPL__
+
+#include <algorithm>
+#include "../search/sa_search.h"
+
+namespace smem {
+
+struct ms_job {
+  uint32_t query;
+  uint32_t begin;
+  sa_search::search_state state;
+};
+
+// Computes the matching statistics of queries [first, last). Up to
+// SMEM_INTERLEAVE searches run together: each round first prefetches the
+// suffix array entries at their midpoints, then the text they point to,
+// then compares.
+template <typename T>
+void matching_statistics(const unsigned char* text, uint64_t size,
+                         const T* suffix_array,
+                         const std::vector<std::string>& queries,
+                         uint32_t first, uint32_t last,
+                         std::vector<std::vector<uint32_t> >& ms) {
+  ms_job jobs[SMEM_INTERLEAVE];
+  T suffix[SMEM_INTERLEAVE];
+  uint32_t active = 0;
+  uint32_t next_query = first, next_begin = 0;
+  for (uint32_t q = first; q < last; q++) {
+    ms[q - first].assign(queries[q].size(), 0);
+  }
+
+  while (true) {
+    while (active < SMEM_INTERLEAVE && next_query < last) {
+      if (next_begin == queries[next_query].size()) {
+        next_query++;
+        next_begin = 0;
+        continue;
+      }
+      ms_job& job = jobs[active++];
+      job.query = next_query;
+      job.begin = next_begin;
+      const std::string& q = queries[next_query];
+      sa_search::init(
+          job.state,
+          reinterpret_cast<const unsigned char*>(q.data()) + next_begin,
+          q.size() - next_begin, size);
+      next_begin++;
+    }
+    if (active == 0) {
+      break;
+    }
+
+    for (uint32_t j = 0; j < active; j++) {
+      if (!sa_search::done(jobs[j].state)) {
+        __builtin_prefetch(&suffix_array[sa_search::midpoint(jobs[j].state)]);
+      }
+    }
+    for (uint32_t j = 0; j < active; j++) {
+      const sa_search::search_state& s = jobs[j].state;
+      if (!sa_search::done(s)) {
+        suffix[j] = suffix_array[sa_search::midpoint(s)];
+        __builtin_prefetch(text + suffix[j] +
+                           std::min(s.left_lcp, s.right_lcp));
+      }
+    }
+    // Walk down so that a finished job can be replaced by the last one.
+    for (uint32_t j = active; j-- > 0;) {
+      sa_search::search_state& s = jobs[j].state;
+      if (!sa_search::done(s)) {
+        sa_search::step(s, text, size, suffix[j]);
+      }
+      if (sa_search::done(s)) {
+        ms[jobs[j].query - first][jobs[j].begin] =
+            std::max(s.left_lcp, s.right_lcp);
+        active--;
+        jobs[j] = jobs[active];
+        suffix[j] = suffix[active];
+      }
+    }
+  }
+}
+
+template <typename T>
+void find_smems(const unsigned char* text, uint64_t size,
+                const T* suffix_array, const std::vector<std::string>& queries,
+                uint32_t min_length, std::vector<std::vector<mem_hit> >& hits) {
+  const int64_t num_queries = queries.size();
+  hits.assign(num_queries, std::vector<mem_hit>());
+
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int64_t first = 0; first < num_queries; first += SMEM_CHUNK) {
+    const uint32_t last = std::min(num_queries, first + SMEM_CHUNK);
+    std::vector<std::vector<uint32_t> > ms(last - first);
+    matching_statistics(text, size, suffix_array, queries, first, last, ms);
+
+    // The match at i is contained in an earlier one exactly when it is
+    // contained in the match at i - 1.
+    for (uint32_t q = first; q < last; q++) {
+      const std::vector<uint32_t>& m = ms[q - first];
+      const unsigned char* query =
+          reinterpret_cast<const unsigned char*>(queries[q].data());
+      for (uint32_t i = 0; i < m.size(); i++) {
+        if (m[i] >= min_length && (i == 0 || m[i - 1] <= m[i])) {
+          mem_hit hit;
+          hit.begin = i;
+          hit.length = m[i];
+          sa_search::find_range(text, size, suffix_array, query + i, m[i],
+                                hit.sa_begin, hit.sa_end);
+          hits[q].push_back(hit);
+        }
+      }
+    }
+  }
+}
+}
+
+#endif
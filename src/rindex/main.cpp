@@ -0,0 +1,57 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include "../search/index.h"
+#include "r_index.h"
+
+using namespace std;
+
+// One pattern per line; each output line is the line number, the count and
+// up to MAX_LISTED_OCC text positions.
+int main(int argc, char* argv[]) {
+  if (argc != 4) {
+    fprintf(stderr, "Usage: %s <r-index> <patterns> <output>\n", argv[0]);
+    return 1;
+  }
+  RIndex index;
+  if (index.load(argv[1]) < 0) {
+    fprintf(stderr, "Failed to load %s\n", argv[1]);
+    return 1;
+  }
+  fprintf(stdout, "Loaded %lu characters in %lu runs\n", index.size(),
+          index.runs());
+
+  vector<string> patterns;
+  if (read_lines(argv[2], patterns) < 0) {
+    fprintf(stderr, "Failed to read %s\n", argv[2]);
+    return 1;
+  }
+
+  vector<string> lines(patterns.size());
+#pragma omp parallel for schedule(dynamic, 16)
+  for (size_t q = 0; q < patterns.size(); q++) {
+    vector<uint64_t> positions;
+    const uint64_t occ = index.locate(
+        reinterpret_cast<const unsigned char*>(patterns[q].data()),
+        patterns[q].size(), MAX_LISTED_OCC, positions);
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%zu\t%lu", q, occ);
+    lines[q] = buf;
+    for (size_t i = 0; i < positions.size(); i++) {
+      snprintf(buf, sizeof(buf), "%c%lu", i == 0 ? '\t' : ',', positions[i]);
+      lines[q] += buf;
+    }
+    lines[q] += '\n';
+  }
+
+  FILE* f = fopen(argv[3], "w");
+  if (f == NULL) {
+    fprintf(stderr, "Failed to write %s\n", argv[3]);
+    return 1;
+  }
+  for (size_t q = 0; q < lines.size(); q++) {
+    fputs(lines[q].c_str(), f);
+  }
+  return fclose(f) == 0 ? 0 : 1;
+}
@@ -0,0 +1,159 @@
+#include "r_index.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <utility>
+
+int32_t RIndex::load(const char* filename) {
+  FILE* f = fopen(filename, "rb");
+  if (f == NULL) {
+    return -1;
+  }
+  rlbwt_run header;
+  if (fread(&header, sizeof(header), 1, f) != 1 ||
+      header.start != RLBWT_MAGIC || header.first_sa == 0) {
+    fclose(f);
+    return -1;
+  }
+  const uint64_t r = header.first_sa;
+  std::vector<rlbwt_run> runs(r);
+  const bool ok = fread(runs.data(), sizeof(rlbwt_run), r, f) == r;
+  fclose(f);
+  if (!ok) {
+    return -1;
+  }
+
+  size_ = header.head;
+  starts_.resize(r);
+  heads_.resize(r);
+  last_sa_.resize(r);
+  for (uint32_t c = 0; c <= RLBWT_DOLLAR; c++) {
+    runs_of_[c].clear();
+    rows_before_[c].assign(1, 0);
+  }
+  for (uint64_t k = 0; k < r; k++) {
+    const uint64_t end = k + 1 < r ? runs[k + 1].start : size_ + 1;
+    if (runs[k].head > RLBWT_DOLLAR || end <= runs[k].start) {
+      return -1;
+    }
+    starts_[k] = runs[k].start;
+    heads_[k] = runs[k].head;
+    last_sa_[k] = runs[k].last_sa;
+    runs_of_[runs[k].head].push_back(k);
+    rows_before_[runs[k].head].push_back(rows_before_[runs[k].head].back() +
+                                         end - runs[k].start);
+  }
+  uint64_t row = 1;
+  for (uint32_t c = 0; c < RLBWT_DOLLAR; c++) {
+    first_row_[c] = row;
+    row += rows_before_[c].back();
+  }
+
+  // Run 0 starts at the $ row, whose position is never asked for.
+  std::vector<std::pair<uint64_t, uint64_t> > samples;
+  for (uint64_t k = 1; k < r; k++) {
+    samples.push_back(std::make_pair(runs[k].first_sa, runs[k - 1].last_sa));
+  }
+  std::sort(samples.begin(), samples.end());
+  phi_keys_.resize(samples.size());
+  phi_values_.resize(samples.size());
+  for (size_t i = 0; i < samples.size(); i++) {
+    phi_keys_[i] = samples[i].first;
+    phi_values_[i] = samples[i].second;
+  }
+  return 0;
+}
+
+uint64_t RIndex::run_of(uint64_t row) const {
+  return std::upper_bound(starts_.begin(), starts_.end(), row) -
+         starts_.begin() - 1;
+}
+
+// Occurrences of c in rows [0, row).
+uint64_t RIndex::rank(uint32_t c, uint64_t row) const {
+  if (row == 0) {
+    return 0;
+  }
+  const uint64_t k = run_of(row - 1);
+  const std::vector<uint64_t>& runs = runs_of_[c];
+  const uint64_t j = std::lower_bound(runs.begin(), runs.end(), k) -
+                     runs.begin();
+  uint64_t result = rows_before_[c][j];
+  if (heads_[k] == c) {
+    result += row - starts_[k];
+  }
+  return result;
+}
+
+uint64_t RIndex::phi(uint64_t p) const {
+  const uint64_t q = std::upper_bound(phi_keys_.begin(), phi_keys_.end(), p) -
+                     phi_keys_.begin() - 1;
+  return phi_values_[q] + (p - phi_keys_[q]);
+}
+
+// Rows [begin, end) of the pattern, with toehold the suffix array value at
+// row end - 1.
+bool RIndex::backward_search(const unsigned char* pattern, uint32_t length,
+                             uint64_t& begin, uint64_t& end,
+                             uint64_t& toehold) const {
+  begin = 0;
+  end = size_ + 1;
+  if (starts_.empty()) {
+    return false;
+  }
+  toehold = last_sa_.back();
+  for (int64_t i = static_cast<int64_t>(length) - 1; i >= 0; i--) {
+    const uint32_t c = pattern[i];
+    const uint64_t below = rank(c, begin);
+    const uint64_t upto = rank(c, end);
+    if (below == upto) {
+      return false;
+    }
+    // The new last row comes from the last c in the interval, which ends
+    // a run unless it is the interval's last row.
+    const uint64_t k = run_of(end - 1);
+    if (heads_[k] == c) {
+      toehold--;
+    } else {
+      const std::vector<uint64_t>& runs = runs_of_[c];
+      const uint64_t j = std::lower_bound(runs.begin(), runs.end(), k) -
+                         runs.begin();
+      toehold = last_sa_[runs[j - 1]] - 1;
+    }
+    begin = first_row_[c] + below;
+    end = first_row_[c] + upto;
+  }
+  return true;
+}
+
+uint64_t RIndex::count(const unsigned char* pattern, uint32_t length) const {
+  if (length == 0) {
+    return size_;
+  }
+  uint64_t begin, end, toehold;
+  return backward_search(pattern, length, begin, end, toehold) ? end - begin
+                                                               : 0;
+}
+
+uint64_t RIndex::locate(const unsigned char* pattern, uint32_t length,
+                        uint64_t limit,
+                        std::vector<uint64_t>& positions) const {
+  if (length == 0) {
+    for (uint64_t p = 0; p < size_ && p < limit; p++) {
+      positions.push_back(p);
+    }
+    return size_;
+  }
+  uint64_t begin, end, p;
+  if (!backward_search(pattern, length, begin, end, p)) {
+    return 0;
+  }
+  const uint64_t occ = end - begin;
+  for (uint64_t i = 0; i < occ && i < limit; i++) {
+    if (i > 0) {
+      p = phi(p);
+    }
+    positions.push_back(p);
+  }
+  return occ;
+}
@@ -0,0 +1,56 @@
+#ifndef __R_INDEX__
+#define __R_INDEX__
+
+#include <stdint.h>
+#include <vector>
+#include "../lc_suffix_array/run_length_bwt.h"
+
+/*
+ * r-index over the run-length BWT written by the lc builder with -r. All
+ * structures are O(r) words for r BWT runs.
+ *
+ * Counting is backward search with rank over the runs. Locating keeps the
+ * toehold of Gagie, Navarro and Prezza: the suffix array value at the last
+ * row of the current interval, updated from the run samples at each step.
+ * The remaining occurrences follow from phi(p) = SA[ISA[p] - 1], which
+ * satisfies phi(p) = phi(q) + p - q for q the nearest position at or before
+ * p whose row starts a run, so one predecessor search per occurrence.
+ */
+class RIndex {
+ public:
+  RIndex() : size_(0) {}
+
+  int32_t load(const char* filename);
+
+  uint64_t size() const { return size_; }
+  uint64_t runs() const { return starts_.size(); }
+
+  uint64_t count(const unsigned char* pattern, uint32_t length) const;
+
+  // Appends up to limit text positions of the pattern, in suffix array
+  // order from the last, and returns the number of occurrences.
+  uint64_t locate(const unsigned char* pattern, uint32_t length,
+                  uint64_t limit, std::vector<uint64_t>& positions) const;
+
+ private:
+  uint64_t run_of(uint64_t row) const;
+  uint64_t rank(uint32_t c, uint64_t row) const;
+  uint64_t phi(uint64_t p) const;
+  bool backward_search(const unsigned char* pattern, uint32_t length,
+                       uint64_t& begin, uint64_t& end,
+                       uint64_t& toehold) const;
+
+  uint64_t size_;
+  uint64_t first_row_[RLBWT_DOLLAR];  // first row of each character
+  std::vector<uint64_t> starts_;
+  std::vector<uint16_t> heads_;
+  std::vector<uint64_t> last_sa_;
+  // Runs of each character and the number of rows in the runs before them.
+  std::vector<uint64_t> runs_of_[RLBWT_DOLLAR + 1];
+  std::vector<uint64_t> rows_before_[RLBWT_DOLLAR + 1];
+  // Run starts by text position, with phi at each.
+  std::vector<uint64_t> phi_keys_;
+  std::vector<uint64_t> phi_values_;
+};
+
+#endif
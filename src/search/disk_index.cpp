@@ -0,0 +1,223 @@
+#include "disk_index.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include "sa_search.h"
+
+// Reads count bytes at offset, across short reads.
+static bool read_at(int fd, void* buf, uint64_t count, uint64_t offset) {
+  char* out = static_cast<char*>(buf);
+  while (count > 0) {
+    const ssize_t got = pread(fd, out, count, offset);
+    if (got < 0 && errno == EINTR) {
+      continue;
+    }
+    if (got <= 0) {
+      return false;
+    }
+    out += got;
+    offset += got;
+    count -= got;
+  }
+  return true;
+}
+
+// A search in progress, with the block of the suffix array around it.
+struct disk_search {
+  sa_search::search_state state;
+  int64_t high;  // right bound from the sample
+  uint64_t block_begin;
+  std::vector<uint64_t> block;
+  uint64_t suffix;
+  std::vector<unsigned char> window;
+};
+
+DiskIndex::DiskIndex()
+    : text_fd_(-1), sa_fd_(-1), size_(0), width_(0), step_(0) {}
+
+DiskIndex::~DiskIndex() {
+  if (text_fd_ >= 0) close(text_fd_);
+  if (sa_fd_ >= 0) close(sa_fd_);
+}
+
+int32_t DiskIndex::open(const char* text_file, const char* sa_file,
+                        uint64_t sample_step) {
+  TextIndex shape;
+  uint64_t file_size = 0, sa_bytes = 0;
+  if (sample_step == 0 ||
+      index_shape(text_file, sa_file, shape, file_size, sa_bytes) < 0) {
+    return -1;
+  }
+  size_ = shape.size;
+  width_ = shape.width;
+  step_ = sample_step;
+  text_fd_ = ::open(text_file, O_RDONLY);
+  sa_fd_ = ::open(sa_file, O_RDONLY);
+  if (text_fd_ < 0 || sa_fd_ < 0) {
+    return -1;
+  }
+
+  const uint64_t samples = (size_ + step_ - 1) / step_;
+  prefixes_.assign(samples * DISK_PREFIX, 0);
+  prefix_lengths_.assign(samples, 0);
+  complete_.assign(samples, false);
+  std::vector<uint8_t> complete(samples, 0);
+  int32_t status = 0;
+#pragma omp parallel for schedule(dynamic, 64) reduction(min : status)
+  for (uint64_t j = 0; j < samples; j++) {
+    uint64_t position = 0;
+    if (read_entry(j * step_, position) < 0 || position >= size_) {
+      status = -1;
+      continue;
+    }
+    const uint32_t length =
+        std::min<uint64_t>(DISK_PREFIX, size_ - position);
+    if (!read_at(text_fd_, &prefixes_[j * DISK_PREFIX], length, position)) {
+      status = -1;
+    }
+    prefix_lengths_[j] = length;
+    complete[j] = length == size_ - position;
+  }
+  for (uint64_t j = 0; j < samples; j++) {
+    complete_[j] = complete[j];
+  }
+  return status;
+}
+
+uint64_t DiskIndex::sample_bytes() const {
+  return prefixes_.size() + prefix_lengths_.size() + complete_.size() / 8;
+}
+
+int32_t DiskIndex::read_entry(uint64_t i, uint64_t& value) const {
+  value = 0;
+  return read_at(sa_fd_, &value, width_, i * width_) ? 0 : -1;
+}
+
+int32_t DiskIndex::entries(uint64_t begin, uint64_t end,
+                           std::vector<uint64_t>& out) const {
+  out.assign(end - begin, 0);
+  if (end == begin) {
+    return 0;
+  }
+  if (width_ == 8) {
+    return read_at(sa_fd_, out.data(), (end - begin) * 8, begin * 8) ? 0
+                                                                      : -1;
+  }
+  std::vector<uint32_t> narrow(end - begin);
+  if (!read_at(sa_fd_, narrow.data(), (end - begin) * 4, begin * 4)) {
+    return -1;
+  }
+  std::copy(narrow.begin(), narrow.end(), out.begin());
+  return 0;
+}
+
+void DiskIndex::sample_bounds(const unsigned char* pattern, uint32_t length,
+                              int64_t& left, int64_t& right) const {
+  // Samples below the pattern come first and samples above it last.
+  const uint64_t samples = prefix_lengths_.size();
+  uint64_t lo = 0, hi = samples;
+  while (lo < hi) {
+    const uint64_t mid = lo + (hi - lo) / 2;
+    if (sa_search::prefix_order(&prefixes_[mid * DISK_PREFIX],
+                                prefix_lengths_[mid], complete_[mid],
+                                pattern, length) < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  left = lo == 0 ? -1 : static_cast<int64_t>((lo - 1) * step_);
+  hi = samples;
+  while (lo < hi) {
+    const uint64_t mid = lo + (hi - lo) / 2;
+    if (sa_search::prefix_order(&prefixes_[mid * DISK_PREFIX],
+                                prefix_lengths_[mid], complete_[mid],
+                                pattern, length) > 0) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  right = lo == samples ? static_cast<int64_t>(size_)
+                        : static_cast<int64_t>(lo * step_);
+}
+
+int32_t DiskIndex::find_ranges(const unsigned char* const* patterns,
+                               const uint32_t* lengths, uint32_t count,
+                               uint64_t* begin, uint64_t* end) const {
+  std::vector<disk_search> searches(count);
+  int32_t status = 0;
+
+  // The blocks between the sample bounds, read together.
+#pragma omp parallel for schedule(dynamic, 1) reduction(min : status)
+  for (uint32_t j = 0; j < count; j++) {
+    disk_search& d = searches[j];
+    int64_t left, right;
+    sample_bounds(patterns[j], lengths[j], left, right);
+    sa_search::init(d.state, patterns[j], lengths[j], size_);
+    d.state.left = left;
+    d.state.right = right;
+    d.high = right;
+    d.block_begin = left + 1;
+    if (static_cast<uint64_t>(right - left - 1) <= DISK_MAX_BLOCK &&
+        entries(left + 1, right, d.block) < 0) {
+      status = -1;
+    }
+  }
+
+  for (int pass = 0; pass < 2 && status == 0; pass++) {
+    if (pass == 1) {
+      for (uint32_t j = 0; j < count; j++) {
+        disk_search& d = searches[j];
+        sa_search::init(d.state, patterns[j], lengths[j], size_, true);
+        d.state.left = static_cast<int64_t>(begin[j]) - 1;
+        d.state.right = d.high;
+      }
+    }
+    bool active = true;
+    while (active && status == 0) {
+      // Every search reads its midpoint's entry, unless it is in the
+      // block, and then the characters it still has to compare.
+#pragma omp parallel for schedule(dynamic, 1) reduction(min : status)
+      for (uint32_t j = 0; j < count; j++) {
+        disk_search& d = searches[j];
+        const sa_search::search_state& s = d.state;
+        if (sa_search::done(s)) {
+          continue;
+        }
+        const uint64_t mid = sa_search::midpoint(s);
+        if (mid >= d.block_begin && mid - d.block_begin < d.block.size()) {
+          d.suffix = d.block[mid - d.block_begin];
+        } else if (read_entry(mid, d.suffix) < 0) {
+          status = -1;
+          continue;
+        }
+        const uint64_t first = std::min(s.left_lcp, s.right_lcp);
+        const uint64_t last =
+            std::min<uint64_t>(s.length, size_ - d.suffix);
+        d.window.resize(last > first ? last - first : 0);
+        if (!d.window.empty() &&
+            !read_at(text_fd_, d.window.data(), d.window.size(),
+                     d.suffix + first)) {
+          status = -1;
+        }
+      }
+      active = false;
+      for (uint32_t j = 0; j < count && status == 0; j++) {
+        disk_search& d = searches[j];
+        if (!sa_search::done(d.state)) {
+          sa_search::step_window(d.state, d.window.data(),
+                                 size_ - d.suffix);
+          active = active || !sa_search::done(d.state);
+        }
+      }
+    }
+    for (uint32_t j = 0; j < count; j++) {
+      (pass == 0 ? begin : end)[j] = searches[j].state.right;
+    }
+  }
+  return status;
+}
@@ -0,0 +1,70 @@
+#ifndef __DISK_INDEX__
+#define __DISK_INDEX__
+
+#include <stdint.h>
+#include <vector>
+#include "index.h"
+
+/*
+ * Searches over a text and suffix array left on disk, for indexes larger
+ * than memory. Memory holds only a sample: the first DISK_PREFIX
+ * characters of every DISK_SAMPLE_STEP-th suffix in suffix array order.
+ * The sample replaces the top levels of the binary search, leaving a block
+ * of about DISK_SAMPLE_STEP entries, which is read with one pread when it
+ * has at most DISK_MAX_BLOCK. The search finishes inside the block, reading
+ * just the characters of each suffix it still has to compare, and goes
+ * entry by entry where a block was too long to read, e.g. for patterns
+ * longer than the sampled prefixes in repetitive text.
+ *
+ * Searches run in lockstep like sa_search::find_ranges. Each round issues
+ * the reads of all of them at once from a pool of OpenMP threads, so the
+ * disk sees them together.
+ */
+const uint64_t DISK_SAMPLE_STEP = 4096;
+const uint32_t DISK_PREFIX = 32;
+const uint64_t DISK_MAX_BLOCK = 2 * DISK_SAMPLE_STEP;
+
+class DiskIndex {
+ public:
+  DiskIndex();
+  ~DiskIndex();
+
+  // Opens the files and reads the sample.
+  int32_t open(const char* text_file, const char* sa_file,
+               uint64_t sample_step = DISK_SAMPLE_STEP);
+
+  uint64_t size() const { return size_; }
+  uint64_t sample_bytes() const;
+
+  // Suffix array intervals [begin, end) of the suffixes starting with each
+  // pattern. Returns -1 if a read fails.
+  int32_t find_ranges(const unsigned char* const* patterns,
+                      const uint32_t* lengths, uint32_t count,
+                      uint64_t* begin, uint64_t* end) const;
+
+  // Suffix array entries [begin, end), with one read.
+  int32_t entries(uint64_t begin, uint64_t end,
+                  std::vector<uint64_t>& out) const;
+
+ private:
+  DiskIndex(const DiskIndex&);
+  DiskIndex& operator=(const DiskIndex&);
+
+  int32_t read_entry(uint64_t i, uint64_t& value) const;
+  // Suffix array indices that the sample puts below and above the
+  // suffixes starting with the pattern, as exclusive bounds.
+  void sample_bounds(const unsigned char* pattern, uint32_t length,
+                     int64_t& left, int64_t& right) const;
+
+  int text_fd_, sa_fd_;
+  uint64_t size_;
+  uint32_t width_;
+  uint64_t step_;
+  // DISK_PREFIX characters per sample, how many are valid, and whether
+  // they are the whole suffix.
+  std::vector<unsigned char> prefixes_;
+  std::vector<uint8_t> prefix_lengths_;
+  std::vector<bool> complete_;
+};
+
+#endif
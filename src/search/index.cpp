@@ -0,0 +1,162 @@
+#include "index.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <fstream>
+#include <new>
+#include "../io/fileio.h"
+
+char* read_whole_file(const char* filename, uint64_t& size, uint64_t extra) {
+  std::ifstream in(filename, std::ifstream::binary);
+  if (!in.good()) {
+    return NULL;
+  }
+  size = get_filesize(filename);
+  char* data = new (std::nothrow) char[size + extra];
+  if (data == NULL) {
+    return NULL;
+  }
+  in.read(data, size);
+  if (static_cast<uint64_t>(in.gcount()) != size) {
+    delete[] data;
+    return NULL;
+  }
+  memset(data + size, 0, extra);
+  return data;
+}
+
+int32_t read_lines(const char* filename, std::vector<std::string>& lines) {
+  uint64_t size = 0;
+  char* data = read_whole_file(filename, size);
+  if (data == NULL) {
+    return -1;
+  }
+  uint64_t start = 0;
+  for (uint64_t i = 0; i <= size; i++) {
+    if (i == size || data[i] == '\n') {
+      uint64_t end = i;
+      if (end > start && data[end - 1] == '\r') end--;
+      if (end > start || i < size) {
+        lines.push_back(std::string(data + start, end - start));
+      }
+      start = i + 1;
+    }
+  }
+  delete[] data;
+  return 0;
+}
+
+int32_t index_shape(const char* text_file, const char* sa_file,
+                    TextIndex& index, uint64_t& file_size,
+                    uint64_t& sa_bytes) {
+  std::ifstream f(text_file);
+  if (!f.good()) {
+    return -1;
+  }
+  f.close();
+  file_size = get_filesize(text_file);
+  sa_bytes = get_filesize(sa_file);
+
+  // Prefer 64-bit entries when both widths would fit the text.
+  index.width = 0;
+  for (uint32_t width = 8; width >= 4; width -= 4) {
+    const uint64_t n = sa_bytes / width;
+    if (sa_bytes % width == 0 && n > 0 &&
+        (n == file_size || n + 1 == file_size)) {
+      index.width = width;
+      index.size = n;
+      break;
+    }
+  }
+  if (index.width == 0) {
+    fprintf(stderr, "Suffix array %s does not match text %s\n", sa_file,
+            text_file);
+    return -1;
+  }
+  return 0;
+}
+
+int32_t load_index(const char* text_file, const char* sa_file,
+                   TextIndex& index) {
+  index.text = NULL;
+  index.suffix_array = NULL;
+  index.text_bytes = 0;
+  index.sa_bytes = 0;
+
+  uint64_t file_size = 0;
+  uint64_t sa_bytes = 0;
+  if (index_shape(text_file, sa_file, index, file_size, sa_bytes) < 0) {
+    return -1;
+  }
+
+  uint64_t text_size = 0;
+  index.text = reinterpret_cast<unsigned char*>(
+      read_whole_file(text_file, text_size, 1));
+  if (index.text == NULL) {
+    return -1;
+  }
+  index.text[index.size] = 0;
+  index.suffix_array = read_whole_file(sa_file, sa_bytes);
+  if (index.suffix_array == NULL) {
+    free_index(index);
+    return -1;
+  }
+  return 0;
+}
+
+// Read-only mapping of a whole file, or NULL.
+static void* map_file(const char* filename, uint64_t bytes) {
+  const int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+  void* data = mmap(NULL, bytes, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  return data == MAP_FAILED ? NULL : data;
+}
+
+int32_t map_index(const char* text_file, const char* sa_file,
+                  TextIndex& index) {
+  index.text = NULL;
+  index.suffix_array = NULL;
+  index.text_bytes = 0;
+  index.sa_bytes = 0;
+
+  uint64_t file_size = 0;
+  uint64_t sa_bytes = 0;
+  if (index_shape(text_file, sa_file, index, file_size, sa_bytes) < 0) {
+    return -1;
+  }
+  index.text = static_cast<unsigned char*>(map_file(text_file, file_size));
+  if (index.text == NULL) {
+    return -1;
+  }
+  index.text_bytes = file_size;
+  index.suffix_array = map_file(sa_file, sa_bytes);
+  if (index.suffix_array == NULL) {
+    free_index(index);
+    return -1;
+  }
+  index.sa_bytes = sa_bytes;
+  return 0;
+}
+
+void free_index(TextIndex& index) {
+  if (index.text_bytes > 0) {
+    munmap(index.text, index.text_bytes);
+  } else {
+    delete[] index.text;
+  }
+  if (index.sa_bytes > 0) {
+    munmap(index.suffix_array, index.sa_bytes);
+  } else {
+    delete[] static_cast<char*>(index.suffix_array);
+  }
+  index.text_bytes = 0;
+  index.sa_bytes = 0;
+  index.text = NULL;
+  index.suffix_array = NULL;
+}
@@ -0,0 +1,55 @@
+#ifndef __SEARCH_INDEX__
+#define __SEARCH_INDEX__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/*
+ * Text plus the suffix array written by the builders. The suffix array
+ * file holds raw host-order integers, 32-bit from the DC3 builder and
+ * 64-bit from the lc builder; the width is inferred from the file sizes.
+ * The DC3 builder may leave out the last character of the file, so the
+ * indexed text is the first size characters.
+ */
+struct TextIndex {
+  unsigned char* text;
+  uint64_t size;
+  void* suffix_array;
+  uint32_t width;  // bytes per suffix array entry, 4 or 8
+  // Lengths of the file mappings made by map_index, 0 after load_index.
+  uint64_t text_bytes, sa_bytes;
+};
+
+// Occurrences the query tools list per match; counts are always exact.
+const uint64_t MAX_LISTED_OCC = 16;
+
+// Reads a whole file into a new[] buffer of size + extra bytes, zero
+// padded. Returns NULL on failure.
+char* read_whole_file(const char* filename, uint64_t& size,
+                      uint64_t extra = 0);
+
+// Appends the lines of a file to lines, split on '\n' with a trailing '\r'
+// dropped; a final '\n' does not start another line. Returns -1 if the
+// file cannot be read, 0 otherwise.
+int32_t read_lines(const char* filename, std::vector<std::string>& lines);
+
+int32_t load_index(const char* text_file, const char* sa_file,
+                   TextIndex& index);
+
+// Same, mapping both files read-only instead of reading them, so that a
+// server starts without reading the whole index and its pages are shared
+// with other processes. The text is not zero padded.
+int32_t map_index(const char* text_file, const char* sa_file,
+                  TextIndex& index);
+
+// Sets only the width and size of an index from the sizes of its files,
+// which it also returns, reading neither.
+int32_t index_shape(const char* text_file, const char* sa_file,
+                    TextIndex& index, uint64_t& file_size,
+                    uint64_t& sa_bytes);
+
+// Releases an index from either load_index or map_index.
+void free_index(TextIndex& index);
+
+#endif
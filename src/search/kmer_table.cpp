@@ -0,0 +1,146 @@
+#include "kmer_table.h"
+
+#include <stdio.h>
+#include <string.h>
+
+const uint32_t KMER_MAGIC = 0x31524d4b;  // "KMR1"
+
+template <typename T>
+static void fill_starts(const unsigned char* text, uint64_t size,
+                        const T* suffix_array, uint32_t k, uint32_t sigma,
+                        const uint16_t* code, std::vector<uint64_t>& starts) {
+  // Ranges of keys between neighbouring suffixes are disjoint, so each
+  // suffix fills its own.
+#pragma omp parallel for
+  for (uint64_t i = 0; i < size; i++) {
+    uint64_t keys[2] = {0, 0};
+    for (uint32_t side = 0; side < 2; side++) {
+      if (side == 0 && i == 0) {
+        continue;
+      }
+      const uint64_t p = suffix_array[side == 0 ? i - 1 : i];
+      for (uint32_t j = 0; j < k; j++) {
+        keys[side] = keys[side] * sigma +
+                     (p + j < size ? code[text[p + j]] - 1 : 0);
+      }
+    }
+    for (uint64_t c = i == 0 ? 0 : keys[0] + 1; c <= keys[1]; c++) {
+      starts[c] = i;
+    }
+  }
+}
+
+KmerTable::KmerTable() : k_(0), sigma_(0), size_(0) {
+  memset(code_, 0, sizeof(code_));
+}
+
+int32_t KmerTable::build(const TextIndex& index, uint32_t k) {
+  bool present[256] = {false};
+  for (uint64_t i = 0; i < index.size; i++) {
+    present[index.text[i]] = true;
+  }
+  sigma_ = 0;
+  for (uint32_t c = 0; c < 256; c++) {
+    code_[c] = present[c] ? ++sigma_ : 0;
+  }
+  if (k == 0 || sigma_ == 0) {
+    return -1;
+  }
+  uint64_t entries = 1;
+  for (uint32_t j = 0; j < k; j++) {
+    entries *= sigma_;
+    if (entries > KMER_MAX_ENTRIES) {
+      return -1;
+    }
+  }
+  k_ = k;
+  size_ = index.size;
+  // Keys past the last suffix's start at the end.
+  starts_.assign(entries + 1, size_);
+  if (index.width == 8) {
+    fill_starts(index.text, size_,
+                static_cast<const uint64_t*>(index.suffix_array), k_, sigma_,
+                code_, starts_);
+  } else {
+    fill_starts(index.text, size_,
+                static_cast<const uint32_t*>(index.suffix_array), k_, sigma_,
+                code_, starts_);
+  }
+  return 0;
+}
+
+void KmerTable::narrow(const unsigned char* pattern, uint32_t length,
+                       uint64_t& begin, uint64_t& end) const {
+  // Lowest and highest keys of the suffixes starting with the pattern.
+  uint64_t low = 0, high = 0;
+  for (uint32_t j = 0; j < k_; j++) {
+    if (j < length) {
+      const uint32_t c = code_[pattern[j]];
+      if (c == 0) {
+        begin = end = 0;
+        return;
+      }
+      low = low * sigma_ + c - 1;
+      high = high * sigma_ + c - 1;
+    } else {
+      low = low * sigma_;
+      high = high * sigma_ + sigma_ - 1;
+    }
+  }
+  begin = starts_[low];
+  end = starts_[high + 1];
+}
+
+/*
+ * File layout (host byte order): u32 magic, u32 k, u32 sigma, u32 unused,
+ * u64 size, the u16 code table, then the starts as a u64 count followed by
+ * the entries.
+ */
+int32_t KmerTable::save(const char* filename) const {
+  FILE* f = fopen(filename, "wb");
+  if (f == NULL) {
+    return -1;
+  }
+  const uint32_t header[4] = {KMER_MAGIC, k_, sigma_, 0};
+  const uint64_t count = starts_.size();
+  bool ok = fwrite(header, sizeof(header), 1, f) == 1 &&
+            fwrite(&size_, sizeof(size_), 1, f) == 1 &&
+            fwrite(code_, sizeof(code_), 1, f) == 1 &&
+            fwrite(&count, sizeof(count), 1, f) == 1 &&
+            fwrite(starts_.data(), sizeof(uint64_t), count, f) == count;
+  ok = (fclose(f) == 0) && ok;
+  return ok ? 0 : -1;
+}
+
+int32_t KmerTable::load(const char* filename) {
+  FILE* f = fopen(filename, "rb");
+  if (f == NULL) {
+    return -1;
+  }
+  uint32_t header[4];
+  uint64_t count = 0;
+  bool ok = fread(header, sizeof(header), 1, f) == 1 &&
+            header[0] == KMER_MAGIC && header[1] >= 1 && header[2] >= 1 &&
+            header[2] <= 256 && fread(&size_, sizeof(size_), 1, f) == 1 &&
+            fread(code_, sizeof(code_), 1, f) == 1 &&
+            fread(&count, sizeof(count), 1, f) == 1 &&
+            count <= KMER_MAX_ENTRIES + 1;
+  // The starts must cover every key of k codes.
+  uint64_t entries = 1;
+  for (uint32_t j = 0; ok && j < header[1]; j++) {
+    entries *= header[2];
+    ok = entries <= KMER_MAX_ENTRIES;
+  }
+  ok = ok && count == entries + 1;
+  if (ok) {
+    starts_.resize(count);
+    ok = fread(starts_.data(), sizeof(uint64_t), count, f) == count;
+  }
+  fclose(f);
+  if (!ok) {
+    return -1;
+  }
+  k_ = header[1];
+  sigma_ = header[2];
+  return 0;
+}
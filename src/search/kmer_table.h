@@ -0,0 +1,52 @@
+#ifndef __KMER_TABLE__
+#define __KMER_TABLE__
+
+#include <stdint.h>
+#include <vector>
+#include "index.h"
+
+/*
+ * Suffix array interval of every k-character prefix, so that the first k
+ * characters of a pattern take one lookup instead of the first, most
+ * cache-missing steps of the binary search.
+ *
+ * The characters occurring in the text get codes 0..sigma-1 in byte order,
+ * and a suffix's key is its first k codes read as a base-sigma number, a
+ * suffix shorter than k being padded with code 0. Keys never decrease along
+ * the suffix array, so starts[c] is the first suffix array index whose key
+ * is at least c, for c up to sigma^k, found in one parallel scan of the
+ * suffix array. The interval of a key may also hold some of the k - 1
+ * shortest suffixes; the search finishing inside it sorts those out.
+ *
+ * The table takes 8 (sigma^k + 1) bytes, at most KMER_MAX_ENTRIES entries.
+ */
+const uint64_t KMER_MAX_ENTRIES = 1 << 27;
+
+class KmerTable {
+ public:
+  KmerTable();
+
+  // From the text and suffix array loaded by load_index or map_index.
+  int32_t build(const TextIndex& index, uint32_t k);
+
+  int32_t save(const char* filename) const;
+  int32_t load(const char* filename);
+
+  uint32_t k() const { return k_; }
+  uint64_t size() const { return size_; }
+
+  // Suffix array interval [begin, end) holding every suffix that starts
+  // with the pattern, and maybe some that do not. Empty if the pattern has
+  // a character the text does not.
+  void narrow(const unsigned char* pattern, uint32_t length, uint64_t& begin,
+              uint64_t& end) const;
+
+ private:
+  uint32_t k_;
+  uint32_t sigma_;
+  uint64_t size_;
+  uint16_t code_[256];  // code + 1 of each character, 0 if absent
+  std::vector<uint64_t> starts_;
+};
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef __SA_SEARCH
+#define __SA_SEARCH
+
+#include <stdint.h>
+#include "kmer_table.h"
+
+namespace sa_search {
+
+// State of one binary search over the suffix array, exposed so that many
+// searches can be advanced in lockstep. left and right are exclusive
+// bounds; left_lcp and right_lcp are the lengths the pattern shares with
+// the suffixes at the bounds, whose minimum every suffix in between also
+// shares (Manber and Myers' mlr heuristic).
+struct search_state {
+  const unsigned char* pattern;
+  uint32_t length;
+  bool upper;  // suffixes starting with the pattern go left (upper bound)
+  int64_t left, right;
+  uint32_t left_lcp, right_lcp;
+};
+
+inline void init(search_state& s, const unsigned char* pattern,
+                 uint32_t length, uint64_t size, bool upper = false);
+
+inline bool done(const search_state& s) { return s.right - s.left <= 1; }
+
+inline int64_t midpoint(const search_state& s) {
+  return s.left + (s.right - s.left) / 2;
+}
+
+// Compares the pattern with the suffix starting at text position suffix,
+// found at suffix array index midpoint(s), and moves one of the bounds.
+inline void step(search_state& s, const unsigned char* text, uint64_t size,
+                 uint64_t suffix);
+
+// Same, given only the part of that suffix still to compare: window holds
+// its characters from min(left_lcp, right_lcp) to the shorter of the
+// pattern and the suffix, and limit is the suffix's length. For text that
+// is read piecewise, e.g. from disk.
+inline void step_window(search_state& s, const unsigned char* window,
+                        uint64_t limit);
+
+// Where a suffix known only by its first key_length characters lies
+// relative to the suffixes starting with the pattern: -1 below all of them,
+// 1 above all of them, 0 if it may be one of them or the key is too short
+// to tell. complete says the key is the whole suffix.
+inline int prefix_order(const unsigned char* key, uint32_t key_length,
+                        bool complete, const unsigned char* pattern,
+                        uint32_t length);
+
+// Length of the longest prefix of the pattern that occurs in the text.
+// sa_index receives a suffix array index where it occurs.
+template <typename T>
+uint32_t longest_match(const unsigned char* text, uint64_t size,
+                       const T* suffix_array, const unsigned char* pattern,
+                       uint32_t length, uint64_t& sa_index);
+
+// Suffix array interval [begin, end) of the suffixes starting with the
+// pattern.
+template <typename T>
+void find_range(const unsigned char* text, uint64_t size,
+                const T* suffix_array, const unsigned char* pattern,
+                uint32_t length, uint64_t& begin, uint64_t& end);
+
+// Runs count searches to the end in lockstep. Each round first prefetches
+// the suffix array entries at their midpoints, then the text they point to,
+// then compares, so the cache misses of different searches overlap.
+// result[i] receives the final right bound of states[i].
+template <typename T>
+void search_batch(const unsigned char* text, uint64_t size,
+                  const T* suffix_array, search_state* states,
+                  uint32_t count, uint64_t* result);
+
+// find_range for count patterns at once, by search_batch.
+template <typename T>
+void find_ranges(const unsigned char* text, uint64_t size,
+                 const T* suffix_array, const unsigned char* const* patterns,
+                 const uint32_t* lengths, uint32_t count, uint64_t* begin,
+                 uint64_t* end);
+
+// Same over a slice of sa_size entries of the suffix array of a text of
+// size characters, e.g. the part one process holds. The intervals are
+// indices into the slice.
+template <typename T>
+void find_ranges(const unsigned char* text, uint64_t size,
+                 const T* suffix_array, uint64_t sa_size,
+                 const unsigned char* const* patterns,
+                 const uint32_t* lengths, uint32_t count, uint64_t* begin,
+                 uint64_t* end);
+
+// Same, each search starting from the interval the table gives for the
+// first k characters of its pattern.
+template <typename T>
+void find_ranges(const KmerTable& table, const unsigned char* text,
+                 uint64_t size, const T* suffix_array,
+                 const unsigned char* const* patterns,
+                 const uint32_t* lengths, uint32_t count, uint64_t* begin,
+                 uint64_t* end);
+}
+
+#include "sa_search.hpp"
+
+#endif
@@ -0,0 +1,190 @@
+#ifndef __SA_SEARCH_IMPL__
+#define __SA_SEARCH_IMPL__
+
+#include <algorithm>
+#include <vector>
+#include "../simd/mismatch.h"
+
+namespace sa_search {
+
+inline void init(search_state& s, const unsigned char* pattern,
+                 uint32_t length, uint64_t size, bool upper) {
+  s.pattern = pattern;
+  s.length = length;
+  s.upper = upper;
+  s.left = -1;
+  s.right = static_cast<int64_t>(size);
+  s.left_lcp = 0;
+  s.right_lcp = 0;
+}
+
+inline void step(search_state& s, const unsigned char* text, uint64_t size,
+                 uint64_t suffix) {
+  step_window(s, text + suffix + std::min(s.left_lcp, s.right_lcp),
+              size - suffix);
+}
+
+inline void step_window(search_state& s, const unsigned char* window,
+                        uint64_t limit) {
+  const int64_t mid = midpoint(s);
+  const uint32_t first = std::min(s.left_lcp, s.right_lcp);
+  uint32_t k = first;
+  while (k < s.length && k < limit && window[k - first] == s.pattern[k]) {
+    k++;
+  }
+  bool go_right;
+  if (k == s.length) {
+    go_right = s.upper;
+  } else if (k == limit) {
+    go_right = true;  // the suffix is a proper prefix of the pattern
+  } else {
+    go_right = window[k - first] < s.pattern[k];
+  }
+  if (go_right) {
+    s.left = mid;
+    s.left_lcp = k;
+  } else {
+    s.right = mid;
+    s.right_lcp = k;
+  }
+}
+
+inline int prefix_order(const unsigned char* key, uint32_t key_length,
+                        bool complete, const unsigned char* pattern,
+                        uint32_t length) {
+  const uint32_t m = std::min(key_length, length);
+  const size_t i = mismatch_bytes(key, pattern, m);
+  if (i < m) {
+    return key[i] < pattern[i] ? -1 : 1;
+  }
+  // A whole suffix that is a proper prefix of the pattern is below it.
+  return complete && key_length < length ? -1 : 0;
+}
+
+template <typename T>
+uint64_t search(const unsigned char* text, uint64_t size,
+                const T* suffix_array, search_state& s) {
+  while (!done(s)) {
+    step(s, text, size, suffix_array[midpoint(s)]);
+  }
+  return s.right;
+}
+
+template <typename T>
+uint32_t longest_match(const unsigned char* text, uint64_t size,
+                       const T* suffix_array, const unsigned char* pattern,
+                       uint32_t length, uint64_t& sa_index) {
+  search_state s;
+  init(s, pattern, length, size);
+  search(text, size, suffix_array, s);
+  if (s.left >= 0 && s.left_lcp >= s.right_lcp) {
+    sa_index = s.left;
+    return s.left_lcp;
+  }
+  sa_index = s.right;
+  return s.right_lcp;
+}
+
+template <typename T>
+void find_range(const unsigned char* text, uint64_t size,
+                const T* suffix_array, const unsigned char* pattern,
+                uint32_t length, uint64_t& begin, uint64_t& end) {
+  search_state s;
+  init(s, pattern, length, size);
+  begin = search(text, size, suffix_array, s);
+  // The upper bound search only needs the part of the array at or after
+  // begin.
+  init(s, pattern, length, size, true);
+  s.left = static_cast<int64_t>(begin) - 1;
+  end = search(text, size, suffix_array, s);
+}
+
+template <typename T>
+void search_batch(const unsigned char* text, uint64_t size,
+                  const T* suffix_array, search_state* states,
+                  uint32_t count, uint64_t* result) {
+  std::vector<uint64_t> suffix(count);
+  bool active = true;
+  while (active) {
+    for (uint32_t j = 0; j < count; j++) {
+      if (!done(states[j])) {
+        __builtin_prefetch(&suffix_array[midpoint(states[j])]);
+      }
+    }
+    for (uint32_t j = 0; j < count; j++) {
+      const search_state& s = states[j];
+      if (!done(s)) {
+        suffix[j] = suffix_array[midpoint(s)];
+        __builtin_prefetch(text + suffix[j] +
+                           std::min(s.left_lcp, s.right_lcp));
+      }
+    }
+    active = false;
+    for (uint32_t j = 0; j < count; j++) {
+      if (!done(states[j])) {
+        step(states[j], text, size, suffix[j]);
+        active = active || !done(states[j]);
+      }
+    }
+  }
+  for (uint32_t j = 0; j < count; j++) {
+    result[j] = states[j].right;
+  }
+}
+
+template <typename T>
+void find_ranges(const unsigned char* text, uint64_t size,
+                 const T* suffix_array, const unsigned char* const* patterns,
+                 const uint32_t* lengths, uint32_t count, uint64_t* begin,
+                 uint64_t* end) {
+  find_ranges(text, size, suffix_array, size, patterns, lengths, count, begin,
+              end);
+}
+
+template <typename T>
+void find_ranges(const unsigned char* text, uint64_t size,
+                 const T* suffix_array, uint64_t sa_size,
+                 const unsigned char* const* patterns,
+                 const uint32_t* lengths, uint32_t count, uint64_t* begin,
+                 uint64_t* end) {
+  std::vector<search_state> states(count);
+  for (uint32_t j = 0; j < count; j++) {
+    init(states[j], patterns[j], lengths[j], sa_size);
+  }
+  search_batch(text, size, suffix_array, states.data(), count, begin);
+  for (uint32_t j = 0; j < count; j++) {
+    init(states[j], patterns[j], lengths[j], sa_size, true);
+    states[j].left = static_cast<int64_t>(begin[j]) - 1;
+  }
+  search_batch(text, size, suffix_array, states.data(), count, end);
+}
+
+template <typename T>
+void find_ranges(const KmerTable& table, const unsigned char* text,
+                 uint64_t size, const T* suffix_array,
+                 const unsigned char* const* patterns,
+                 const uint32_t* lengths, uint32_t count, uint64_t* begin,
+                 uint64_t* end) {
+  // Suffixes before the interval are below the pattern and those after it
+  // above, so it can stand for both bounds. Their common prefixes with the
+  // pattern are unknown, so the mlr lengths start at 0.
+  std::vector<search_state> states(count);
+  std::vector<uint64_t> high(count);
+  for (uint32_t j = 0; j < count; j++) {
+    uint64_t low;
+    table.narrow(patterns[j], lengths[j], low, high[j]);
+    init(states[j], patterns[j], lengths[j], size);
+    states[j].left = static_cast<int64_t>(low) - 1;
+    states[j].right = high[j];
+  }
+  search_batch(text, size, suffix_array, states.data(), count, begin);
+  for (uint32_t j = 0; j < count; j++) {
+    init(states[j], patterns[j], lengths[j], size, true);
+    states[j].left = static_cast<int64_t>(begin[j]) - 1;
+    states[j].right = high[j];
+  }
+  search_batch(text, size, suffix_array, states.data(), count, end);
+}
+}
+
+#endif
@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "../io/local_socket.h"
+#include "../search/index.h"
+#include "../search/kmer_table.h"
+#include "query_server.h"
+
+using namespace std;
+
+// Queries per request sent by the client.
+const uint64_t CLIENT_REQUEST_QUERIES = 256;
+
+// Sends the queries of a file, one per line, and writes one line per query:
+// its line number and its answer. All requests are sent before the replies
+// are read, from a thread of their own, so the server sees them together.
+int query_client(const char* socket_path, const char* query_file,
+                 const char* output) {
+  const int fd = local_connect(socket_path);
+  if (fd < 0) {
+    fprintf(stderr, "Failed to connect to %s\n", socket_path);
+    return 1;
+  }
+  vector<string> queries;
+  if (read_lines(query_file, queries) < 0) {
+    fprintf(stderr, "Failed to read %s\n", query_file);
+    close(fd);
+    return 1;
+  }
+
+  const uint64_t num_requests =
+      (queries.size() + CLIENT_REQUEST_QUERIES - 1) / CLIENT_REQUEST_QUERIES;
+  int32_t sent = 0;
+  thread sender([&]() {
+    for (uint64_t r = 0; r < num_requests && sent == 0; r++) {
+      vector<string> fields(1, to_string(r));
+      const uint64_t first = r * CLIENT_REQUEST_QUERIES;
+      const uint64_t last =
+          min<uint64_t>(first + CLIENT_REQUEST_QUERIES, queries.size());
+      fields.insert(fields.end(), queries.begin() + first,
+                    queries.begin() + last);
+      sent = send_message(fd, fields);
+    }
+  });
+
+  vector<string> answers(queries.size());
+  message_reader reader = {fd, ""};
+  uint64_t received = 0;
+  for (; received < num_requests; received++) {
+    vector<string> reply;
+    if (receive_message(reader, reply) < 0 || reply.empty()) {
+      break;
+    }
+    const uint64_t r = strtoull(reply[0].c_str(), NULL, 10);
+    const uint64_t first = r * CLIENT_REQUEST_QUERIES;
+    for (size_t k = 1; k < reply.size() && first + k - 1 < answers.size();
+         k++) {
+      answers[first + k - 1].swap(reply[k]);
+    }
+  }
+  if (received < num_requests) {
+    // Unblocks a sender stuck on a server that went away.
+    shutdown(fd, SHUT_RDWR);
+  }
+  sender.join();
+  close(fd);
+  if (sent < 0 || received < num_requests) {
+    fprintf(stderr, "No reply from %s\n", socket_path);
+    return 1;
+  }
+
+  FILE* f = fopen(output, "w");
+  if (f == NULL) {
+    fprintf(stderr, "Failed to write %s\n", output);
+    return 1;
+  }
+  for (size_t q = 0; q < answers.size(); q++) {
+    fprintf(f, "%zu\t%s\n", q, answers[q].c_str());
+  }
+  return fclose(f) == 0 ? 0 : 1;
+}
+
+// Asks the server to stop.
+int quit_server(const char* socket_path) {
+  const int fd = local_connect(socket_path);
+  if (fd < 0) {
+    fprintf(stderr, "Failed to connect to %s\n", socket_path);
+    return 1;
+  }
+  vector<string> reply;
+  message_reader reader = {fd, ""};
+  const bool ok = send_message(fd, vector<string>(1, "quit")) == 0 &&
+                  receive_message(reader, reply) == 0;
+  close(fd);
+  return ok ? 0 : 1;
+}
+
+// Builds the k-mer table of an index and saves it.
+int build_table(uint32_t k, const char* text_file, const char* sa_file,
+                const char* table_file) {
+  TextIndex index;
+  if (map_index(text_file, sa_file, index) < 0) {
+    fprintf(stderr, "Failed to map %s and %s\n", text_file, sa_file);
+    return 1;
+  }
+  KmerTable table;
+  int32_t status = table.build(index, k);
+  if (status < 0) {
+    fprintf(stderr, "No table for k = %u within %lu entries\n", k,
+            KMER_MAX_ENTRIES);
+  } else if ((status = table.save(table_file)) < 0) {
+    fprintf(stderr, "Failed to write %s\n", table_file);
+  }
+  free_index(index);
+  return status < 0 ? 1 : 0;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc == 4 && string(argv[1]) == "-c" && string(argv[3]) == "quit") {
+    return quit_server(argv[2]);
+  }
+  if (argc == 5 && string(argv[1]) == "-c") {
+    return query_client(argv[2], argv[3], argv[4]);
+  }
+  if (argc == 6 && string(argv[1]) == "-t") {
+    return build_table(atoi(argv[2]), argv[3], argv[4], argv[5]);
+  }
+  const char* table_file = NULL;
+  if (argc > 2 && string(argv[1]) == "-k") {
+    table_file = argv[2];
+    argv += 2;
+    argc -= 2;
+  }
+  if (argc != 4 && argc != 5) {
+    fprintf(stderr,
+            "Usage: %s [-k <table>] <text> <suffix array> <socket> "
+            "[<threads>]\n"
+            "  or -c <socket> <queries> <output> to send queries, one per "
+            "line, or -c <socket> quit\n"
+            "  or -t <k> <text> <suffix array> <table> to build the k-mer "
+            "table\n",
+            argv[0]);
+    return 1;
+  }
+  TextIndex index;
+  if (map_index(argv[1], argv[2], index) < 0) {
+    fprintf(stderr, "Failed to map %s and %s\n", argv[1], argv[2]);
+    return 1;
+  }
+  KmerTable table;
+  if (table_file != NULL &&
+      (table.load(table_file) < 0 || table.size() != index.size)) {
+    fprintf(stderr, "Table %s does not match the index\n", table_file);
+    free_index(index);
+    return 1;
+  }
+  const int listener = local_listen(argv[3]);
+  if (listener < 0) {
+    fprintf(stderr, "Failed to listen on %s\n", argv[3]);
+    free_index(index);
+    return 1;
+  }
+  const uint32_t threads = argc == 5 ? atoi(argv[4]) : 0;
+  fprintf(stdout, "Serving %lu characters on %s\n", index.size, argv[3]);
+  fflush(stdout);
+  const int32_t status = serve_queries(index, listener, threads,
+                                       table_file != NULL ? &table : NULL);
+  close(listener);
+  unlink(argv[3]);
+  free_index(index);
+  return status < 0 ? 1 : 0;
+}
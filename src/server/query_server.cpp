@@ -0,0 +1,283 @@
+#include "query_server.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include "../io/local_socket.h"
+#include "../search/sa_search.h"
+
+namespace {
+
+struct connection {
+  explicit connection(int fd) : fd(fd) {}
+  ~connection() { close(fd); }
+  int fd;
+  std::mutex write_lock;  // replies come from any worker
+};
+
+// The id and the queries of a request; each answer replaces its query.
+struct request {
+  std::shared_ptr<connection> client;
+  std::vector<std::string> fields;
+  std::atomic<uint32_t> pending;
+};
+
+struct query {
+  std::shared_ptr<request> owner;
+  uint32_t field;
+};
+
+struct query_queue {
+  query_queue() : stopped(false) {}
+  std::mutex lock;
+  std::condition_variable ready;
+  std::deque<query> queries;
+  bool stopped;
+};
+
+enum query_kind { QUERY_COUNT, QUERY_LOCATE, QUERY_EXTRACT, QUERY_BAD };
+
+struct parsed_query {
+  query_kind kind;
+  const unsigned char* pattern;
+  uint32_t length;
+  uint64_t position;  // extract position, or locate max
+  uint64_t extent;    // extract length
+};
+
+bool starts_with(const std::string& field, const char* prefix) {
+  return field.compare(0, strlen(prefix), prefix) == 0;
+}
+
+parsed_query parse_query(const std::string& field) {
+  parsed_query q;
+  q.kind = QUERY_BAD;
+  q.pattern = NULL;
+  q.length = 0;
+  q.position = 0;
+  q.extent = 0;
+  size_t start = 0;
+  if (starts_with(field, "count ")) {
+    q.kind = QUERY_COUNT;
+    start = 6;
+  } else if (starts_with(field, "locate ")) {
+    char* end;
+    q.position = strtoull(field.c_str() + 7, &end, 10);
+    if (end != field.c_str() + 7 && *end == ' ') {
+      q.kind = QUERY_LOCATE;
+      start = end + 1 - field.c_str();
+    }
+  } else if (starts_with(field, "extract ")) {
+    char* end;
+    q.position = strtoull(field.c_str() + 8, &end, 10);
+    if (end != field.c_str() + 8 && *end == ' ') {
+      const char* length = end + 1;
+      q.extent = strtoull(length, &end, 10);
+      if (end != length && *end == 0) {
+        q.kind = QUERY_EXTRACT;
+      }
+    }
+  }
+  if (q.kind == QUERY_COUNT || q.kind == QUERY_LOCATE) {
+    q.pattern = reinterpret_cast<const unsigned char*>(field.data()) + start;
+    q.length = field.size() - start;
+  }
+  return q;
+}
+
+std::string escape(const unsigned char* text, uint64_t length) {
+  std::string out;
+  out.reserve(length);
+  for (uint64_t i = 0; i < length; i++) {
+    if (text[i] == '\\') {
+      out += "\\\\";
+    } else if (text[i] == '\n') {
+      out += "\\n";
+    } else {
+      out += static_cast<char>(text[i]);
+    }
+  }
+  return out;
+}
+
+// Answers a batch of queries, the searches all in lockstep.
+template <typename T>
+void answer_batch(const TextIndex& index, const KmerTable* table,
+                  const std::vector<query>& batch,
+                  std::vector<std::string>& answers) {
+  const T* suffix_array = static_cast<const T*>(index.suffix_array);
+  const uint32_t count = batch.size();
+  std::vector<parsed_query> parsed(count);
+  std::vector<const unsigned char*> patterns;
+  std::vector<uint32_t> lengths;
+  std::vector<uint32_t> searched;
+  for (uint32_t j = 0; j < count; j++) {
+    parsed[j] = parse_query(batch[j].owner->fields[batch[j].field]);
+    if (parsed[j].kind == QUERY_COUNT || parsed[j].kind == QUERY_LOCATE) {
+      patterns.push_back(parsed[j].pattern);
+      lengths.push_back(parsed[j].length);
+      searched.push_back(j);
+    }
+  }
+  std::vector<uint64_t> begin(searched.size()), end(searched.size());
+  if (table != NULL) {
+    sa_search::find_ranges(*table, index.text, index.size, suffix_array,
+                           patterns.data(), lengths.data(), searched.size(),
+                           begin.data(), end.data());
+  } else {
+    sa_search::find_ranges(index.text, index.size, suffix_array,
+                           patterns.data(), lengths.data(), searched.size(),
+                           begin.data(), end.data());
+  }
+
+  answers.assign(count, "error");
+  char buf[32];
+  for (uint32_t k = 0; k < searched.size(); k++) {
+    const parsed_query& q = parsed[searched[k]];
+    std::string& answer = answers[searched[k]];
+    snprintf(buf, sizeof(buf), "%lu", end[k] - begin[k]);
+    answer = buf;
+    if (q.kind == QUERY_LOCATE) {
+      const uint64_t listed = std::min(end[k] - begin[k], q.position);
+      for (uint64_t i = 0; i < listed; i++) {
+        snprintf(buf, sizeof(buf), "%c%lu", i == 0 ? '\t' : ',',
+                 static_cast<uint64_t>(suffix_array[begin[k] + i]));
+        answer += buf;
+      }
+    }
+  }
+  for (uint32_t j = 0; j < count; j++) {
+    const parsed_query& q = parsed[j];
+    if (q.kind == QUERY_EXTRACT) {
+      const uint64_t position = std::min(q.position, index.size);
+      const uint64_t length = std::min(q.extent, index.size - position);
+      snprintf(buf, sizeof(buf), "%lu\t", length);
+      answers[j] = buf + escape(index.text + position, length);
+    }
+  }
+}
+
+template <typename T>
+void work(const TextIndex& index, const KmerTable* table,
+          query_queue& queue) {
+  std::vector<query> batch;
+  std::vector<std::string> answers;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> hold(queue.lock);
+      while (!queue.stopped && queue.queries.empty()) {
+        queue.ready.wait(hold);
+      }
+      if (queue.queries.empty()) {
+        return;
+      }
+      while (batch.size() < SERVER_BATCH && !queue.queries.empty()) {
+        batch.push_back(queue.queries.front());
+        queue.queries.pop_front();
+      }
+    }
+    answer_batch<T>(index, table, batch, answers);
+    for (size_t j = 0; j < batch.size(); j++) {
+      request& r = *batch[j].owner;
+      r.fields[batch[j].field].swap(answers[j]);
+      if (r.pending.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> hold(r.client->write_lock);
+        send_message(r.client->fd, r.fields);
+      }
+    }
+    batch.clear();
+  }
+}
+
+void read_requests(std::shared_ptr<connection> client,
+                   std::shared_ptr<query_queue> queue, int listener) {
+  message_reader reader = {client->fd, ""};
+  std::vector<std::string> fields;
+  while (receive_message(reader, fields) == 0) {
+    if (fields.size() == 1 && fields[0] == "quit") {
+      {
+        std::lock_guard<std::mutex> hold(queue->lock);
+        queue->stopped = true;
+      }
+      queue->ready.notify_all();
+      {
+        std::lock_guard<std::mutex> hold(client->write_lock);
+        send_message(client->fd, std::vector<std::string>(1, "ok"));
+      }
+      // Wakes the accept loop.
+      shutdown(listener, SHUT_RDWR);
+      return;
+    }
+    if (fields.empty()) {
+      continue;
+    }
+    std::shared_ptr<request> r(new request);
+    r->client = client;
+    r->fields.swap(fields);
+    r->pending = r->fields.size() - 1;
+    if (r->pending == 0) {
+      std::lock_guard<std::mutex> hold(client->write_lock);
+      send_message(client->fd, r->fields);
+      continue;
+    }
+    {
+      std::lock_guard<std::mutex> hold(queue->lock);
+      if (queue->stopped) {
+        return;
+      }
+      for (uint32_t k = 1; k < r->fields.size(); k++) {
+        query q = {r, k};
+        queue->queries.push_back(q);
+      }
+    }
+    queue->ready.notify_all();
+  }
+}
+}
+
+int32_t serve_queries(const TextIndex& index, int listener, uint32_t threads,
+                      const KmerTable* table) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  // Readers may outlive this call, blocked on idle connections.
+  std::shared_ptr<query_queue> queue(new query_queue);
+  std::vector<std::thread> workers;
+  for (uint32_t t = 0; t < threads; t++) {
+    if (index.width == 4) {
+      workers.push_back(std::thread(work<uint32_t>, std::cref(index), table,
+                                    std::ref(*queue)));
+    } else {
+      workers.push_back(std::thread(work<uint64_t>, std::cref(index), table,
+                                    std::ref(*queue)));
+    }
+  }
+  while (true) {
+    const int fd = local_accept(listener);
+    if (fd < 0) {
+      std::lock_guard<std::mutex> hold(queue->lock);
+      if (queue->stopped) {
+        break;
+      }
+      continue;
+    }
+    std::thread(read_requests,
+                std::shared_ptr<connection>(new connection(fd)), queue,
+                listener).detach();
+  }
+  for (uint32_t t = 0; t < threads; t++) {
+    workers[t].join();
+  }
+  return 0;
+}
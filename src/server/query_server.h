@@ -0,0 +1,40 @@
+#ifndef __QUERY_SERVER__
+#define __QUERY_SERVER__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "../search/index.h"
+#include "../search/kmer_table.h"
+
+/*
+ * Count, locate and extract queries over an index from map_index, served on
+ * a local socket (io/local_socket.h). A request is an id followed by one
+ * query per field:
+ *
+ *   count <pattern>
+ *   locate <max> <pattern>
+ *   extract <position> <length>
+ *
+ * The pattern is the rest of the field. The reply is the id followed by one
+ * answer per query: the count; the count, a tab and up to max positions
+ * separated by commas; or the length, a tab and the text with backslash
+ * and newline escaped as \\ and \n. A malformed query is answered "error".
+ * A request of just "quit" stops the server.
+ *
+ * A thread per connection reads requests and queues their queries. Workers
+ * take up to SERVER_BATCH queued queries at a time, from any connections,
+ * and run their searches in lockstep with search_batch, so the cache misses
+ * of one search overlap those of the others. The worker that answers the
+ * last query of a request sends the reply right away, so requests
+ * pipelined on one connection may be answered out of order; the id tells
+ * them apart. With a k-mer table the searches start from the interval of
+ * their pattern's first k characters.
+ */
+const uint32_t SERVER_BATCH = 64;
+
+// Serves requests from a listening socket until one says quit. threads 0
+// means one worker per core. table may be NULL.
+int32_t serve_queries(const TextIndex& index, int listener, uint32_t threads,
+                      const KmerTable* table = NULL);
+
+#endif
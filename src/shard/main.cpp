@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include "mpi.h"
+#include "../search/index.h"
+#include "sharded_index.h"
+
+using namespace std;
+
+// Each process takes an even slice of the suffix array from the mapped
+// file, and the patterns are answered by the slices that can hold them.
+// Output as rindex: line number, count and up to MAX_LISTED_OCC positions.
+int main(int argc, char* argv[]) {
+  MPI_Init(&argc, &argv);
+  int numprocs, myid;
+  MPI_Comm_size(MPI_COMM_WORLD, &numprocs);
+  MPI_Comm_rank(MPI_COMM_WORLD, &myid);
+  if (argc != 5) {
+    if (myid == 0) {
+      fprintf(stderr, "Usage: %s <text> <suffix array> <patterns> <output>\n",
+              argv[0]);
+    }
+    MPI_Finalize();
+    return 1;
+  }
+
+  TextIndex index;
+  int32_t status = map_index(argv[1], argv[2], index);
+  int32_t all_status = status;
+  MPI_Allreduce(&status, &all_status, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+  if (all_status < 0) {
+    if (myid == 0) fprintf(stderr, "Failed to map %s and %s\n", argv[1], argv[2]);
+    MPI_Finalize();
+    return 1;
+  }
+  // An even split of the suffix array, leaving slices empty when there are
+  // more processes than suffixes.
+  const uint64_t offset = index.size * myid / numprocs;
+  const uint64_t count = index.size * (myid + 1) / numprocs - offset;
+  const void* slice =
+      static_cast<const char*>(index.suffix_array) + offset * index.width;
+
+  ShardedIndex shards;
+  vector<string> patterns;
+  vector<uint64_t> counts;
+  vector<vector<uint64_t> > positions;
+  status = 0;
+  if (myid == 0 && read_lines(argv[3], patterns) < 0) {
+    fprintf(stderr, "Failed to read %s\n", argv[3]);
+    status = -1;
+  }
+  MPI_Bcast(&status, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  double elapsed = MPI::Wtime();
+  if (status == 0 &&
+      (shards.open(index.text, index.size, slice, index.width, offset,
+                   count) < 0 ||
+       shards.query(patterns, MAX_LISTED_OCC, counts, positions) < 0)) {
+    if (myid == 0) fprintf(stderr, "Query failed\n");
+    status = -1;
+  }
+  elapsed = MPI::Wtime() - elapsed;
+
+  if (status == 0 && myid == 0) {
+    fprintf(stdout, "Answered %zu patterns on %d slices in %f s\n",
+            patterns.size(), numprocs, elapsed);
+    FILE* f = fopen(argv[4], "w");
+    if (f == NULL) {
+      fprintf(stderr, "Failed to write %s\n", argv[4]);
+      status = -1;
+    } else {
+      for (size_t q = 0; q < patterns.size(); q++) {
+        fprintf(f, "%zu\t%lu", q, counts[q]);
+        for (size_t i = 0; i < positions[q].size(); i++) {
+          fprintf(f, "%c%lu", i == 0 ? '\t' : ',', positions[q][i]);
+        }
+        fprintf(f, "\n");
+      }
+      status = fclose(f) == 0 ? 0 : -1;
+    }
+  }
+  free_index(index);
+  MPI_Finalize();
+  return status < 0 ? 1 : 0;
+}
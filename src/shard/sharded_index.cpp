@@ -0,0 +1,268 @@
+#include "sharded_index.h"
+
+#include <limits.h>
+#include <string.h>
+#include <algorithm>
+#include "../search/sa_search.h"
+
+// Routing record: empty flag, complete flag, prefix length, prefix.
+const uint32_t ROUTE_RECORD = 8 + SHARD_ROUTE_PREFIX;
+
+ShardedIndex::ShardedIndex()
+    : text_(NULL), size_(0), slice_(NULL), width_(0), offset_(0),
+      count_(0), comm_(MPI_COMM_WORLD), numprocs_(1), myid_(0) {}
+
+int32_t ShardedIndex::open(const unsigned char* text, uint64_t size,
+                           const void* slice, uint32_t width,
+                           uint64_t offset, uint64_t count, MPI_Comm comm) {
+  text_ = text;
+  size_ = size;
+  slice_ = slice;
+  width_ = width;
+  offset_ = offset;
+  count_ = count;
+  comm_ = comm;
+  MPI_Comm_size(comm, &numprocs_);
+  MPI_Comm_rank(comm, &myid_);
+
+  int32_t status = (width == 4 || width == 8) && offset <= size &&
+                           count <= size - offset
+                       ? 0
+                       : -1;
+  char record[ROUTE_RECORD];
+  memset(record, 0, sizeof(record));
+  record[0] = count == 0 || status < 0;
+  if (!record[0]) {
+    const uint64_t first =
+        width == 4 ? static_cast<const uint32_t*>(slice)[0]
+                   : static_cast<const uint64_t*>(slice)[0];
+    if (first >= size) {
+      status = -1;
+    } else {
+      const uint32_t length =
+          std::min<uint64_t>(SHARD_ROUTE_PREFIX, size - first);
+      record[1] = length == size - first;
+      memcpy(record + 4, &length, sizeof(length));
+      memcpy(record + 8, text + first, length);
+    }
+  }
+  int32_t all_status = status;
+  MPI_Allreduce(&status, &all_status, 1, MPI_INT, MPI_MIN, comm);
+  if (all_status < 0) {
+    return -1;
+  }
+
+  std::vector<char> records(static_cast<uint64_t>(numprocs_) * ROUTE_RECORD);
+  MPI_Allgather(record, ROUTE_RECORD, MPI_CHAR, &records[0], ROUTE_RECORD,
+                MPI_CHAR, comm);
+  empty_.assign(numprocs_, true);
+  complete_.assign(numprocs_, false);
+  first_suffix_.assign(numprocs_, std::string());
+  for (int r = 0; r < numprocs_; r++) {
+    const char* rec = &records[static_cast<uint64_t>(r) * ROUTE_RECORD];
+    uint32_t length;
+    memcpy(&length, rec + 4, sizeof(length));
+    empty_[r] = rec[0];
+    complete_[r] = rec[1];
+    first_suffix_[r].assign(rec + 8, length);
+  }
+  return 0;
+}
+
+bool ShardedIndex::above(int r, const unsigned char* pattern,
+                         uint32_t length) const {
+  const std::string& key = first_suffix_[r];
+  return sa_search::prefix_order(
+             reinterpret_cast<const unsigned char*>(key.data()), key.size(),
+             complete_[r], pattern, length) > 0;
+}
+
+bool ShardedIndex::below(int r, const unsigned char* pattern,
+                         uint32_t length) const {
+  const std::string& key = first_suffix_[r];
+  return sa_search::prefix_order(
+             reinterpret_cast<const unsigned char*>(key.data()), key.size(),
+             complete_[r], pattern, length) < 0;
+}
+
+void ShardedIndex::route(const unsigned char* pattern, uint32_t length,
+                         int& first, int& last) const {
+  first = numprocs_;
+  last = -1;
+  for (int r = 0; r < numprocs_; r++) {
+    if (empty_[r]) {
+      continue;
+    }
+    // Slices are in suffix order, so once one starts above the pattern
+    // every later one does.
+    if (above(r, pattern, length)) {
+      break;
+    }
+    int next = r + 1;
+    while (next < numprocs_ && empty_[next]) next++;
+    if (next < numprocs_ && below(next, pattern, length)) {
+      continue;
+    }
+    first = std::min(first, r);
+    last = r;
+  }
+}
+
+// Requests are u64 pattern index, u32 length and the pattern; replies are
+// u64 pattern index, u64 count, u64 number listed and the positions.
+template <typename T>
+void ShardedIndex::search(const char* requests, uint64_t bytes,
+                          uint64_t max_listed,
+                          std::vector<char>& replies) const {
+  const T* slice = static_cast<const T*>(slice_);
+  std::vector<uint64_t> ids;
+  std::vector<const unsigned char*> patterns;
+  std::vector<uint32_t> lengths;
+  for (uint64_t at = 0; at < bytes;) {
+    uint64_t id;
+    uint32_t length;
+    memcpy(&id, requests + at, sizeof(id));
+    memcpy(&length, requests + at + 8, sizeof(length));
+    ids.push_back(id);
+    lengths.push_back(length);
+    patterns.push_back(
+        reinterpret_cast<const unsigned char*>(requests + at + 12));
+    at += 12 + length;
+  }
+
+  replies.clear();
+  uint64_t begin[SHARD_BATCH], end[SHARD_BATCH];
+  for (uint64_t first = 0; first < ids.size(); first += SHARD_BATCH) {
+    const uint32_t batch =
+        std::min<uint64_t>(SHARD_BATCH, ids.size() - first);
+    sa_search::find_ranges(text_, size_, slice, count_, &patterns[first],
+                           &lengths[first], batch, begin, end);
+    for (uint32_t j = 0; j < batch; j++) {
+      const uint64_t count = end[j] - begin[j];
+      if (count == 0) {
+        continue;
+      }
+      const uint64_t listed = std::min(count, max_listed);
+      uint64_t fields[3] = {ids[first + j], count, listed};
+      const uint64_t at = replies.size();
+      replies.resize(at + sizeof(fields) + listed * sizeof(uint64_t));
+      memcpy(&replies[at], fields, sizeof(fields));
+      for (uint64_t i = 0; i < listed; i++) {
+        const uint64_t position = slice[begin[j] + i];
+        memcpy(&replies[at + sizeof(fields) + i * sizeof(uint64_t)],
+               &position, sizeof(position));
+      }
+    }
+  }
+}
+
+int32_t ShardedIndex::query(
+    const std::vector<std::string>& patterns, uint64_t max_listed,
+    std::vector<uint64_t>& counts,
+    std::vector<std::vector<uint64_t> >& positions) const {
+  uint64_t total = myid_ == 0 ? patterns.size() : 0;
+  MPI_Bcast(&total, 1, MPI_UNSIGNED_LONG_LONG, 0, comm_);
+  if (myid_ == 0) {
+    counts.assign(total, 0);
+    positions.assign(total, std::vector<uint64_t>());
+  }
+
+  for (uint64_t round = 0; round < total; round += SHARD_ROUND) {
+    const uint64_t round_end = std::min(round + SHARD_ROUND, total);
+    std::vector<int> send_counts(numprocs_, 0), send_displs(numprocs_, 0);
+    std::vector<char> send;
+    int32_t status = 0;
+    if (myid_ == 0) {
+      std::vector<std::string> out(numprocs_);
+      for (uint64_t q = round; q < round_end; q++) {
+        const unsigned char* pattern =
+            reinterpret_cast<const unsigned char*>(patterns[q].data());
+        const uint32_t length = patterns[q].size();
+        int first, last;
+        route(pattern, length, first, last);
+        for (int r = first; r <= last; r++) {
+          out[r].append(reinterpret_cast<const char*>(&q), sizeof(q));
+          out[r].append(reinterpret_cast<const char*>(&length),
+                        sizeof(length));
+          out[r].append(patterns[q]);
+        }
+      }
+      uint64_t bytes = 0;
+      for (int r = 0; r < numprocs_; r++) {
+        send_displs[r] = bytes;
+        send_counts[r] = out[r].size();
+        bytes += out[r].size();
+      }
+      if (bytes > INT_MAX) {
+        status = -1;
+      } else {
+        send.resize(bytes + 1);
+        for (int r = 0; r < numprocs_; r++) {
+          memcpy(&send[send_displs[r]], out[r].data(), out[r].size());
+        }
+      }
+    }
+    MPI_Bcast(&status, 1, MPI_INT, 0, comm_);
+    if (status < 0) {
+      return -1;
+    }
+
+    int recv_count = 0;
+    MPI_Scatter(&send_counts[0], 1, MPI_INT, &recv_count, 1, MPI_INT, 0,
+                comm_);
+    std::vector<char> requests(recv_count + 1);
+    MPI_Scatterv(myid_ == 0 ? &send[0] : NULL, &send_counts[0],
+                 &send_displs[0], MPI_CHAR, &requests[0], recv_count,
+                 MPI_CHAR, 0, comm_);
+
+    std::vector<char> replies;
+    if (width_ == 4) {
+      search<uint32_t>(&requests[0], recv_count, max_listed, replies);
+    } else {
+      search<uint64_t>(&requests[0], recv_count, max_listed, replies);
+    }
+    status = replies.size() > INT_MAX ? -1 : 0;
+    int32_t all_status = status;
+    MPI_Allreduce(&status, &all_status, 1, MPI_INT, MPI_MIN, comm_);
+    if (all_status < 0) {
+      return -1;
+    }
+
+    // Gathered in rank order, which is suffix array order.
+    const int reply_bytes = replies.size();
+    std::vector<int> recv_counts(numprocs_, 0), recv_displs(numprocs_, 0);
+    MPI_Gather(&reply_bytes, 1, MPI_INT, &recv_counts[0], 1, MPI_INT, 0,
+               comm_);
+    uint64_t gathered = 0;
+    if (myid_ == 0) {
+      for (int r = 0; r < numprocs_; r++) {
+        recv_displs[r] = gathered;
+        gathered += recv_counts[r];
+      }
+      status = gathered > INT_MAX ? -1 : 0;
+    }
+    MPI_Bcast(&status, 1, MPI_INT, 0, comm_);
+    if (status < 0) {
+      return -1;
+    }
+    replies.push_back(0);
+    std::vector<char> all(gathered + 1);
+    MPI_Gatherv(&replies[0], reply_bytes, MPI_CHAR, &all[0], &recv_counts[0],
+                &recv_displs[0], MPI_CHAR, 0, comm_);
+    for (uint64_t at = 0; at < gathered;) {
+      uint64_t fields[3];
+      memcpy(fields, &all[at], sizeof(fields));
+      at += sizeof(fields);
+      counts[fields[0]] += fields[1];
+      std::vector<uint64_t>& listed = positions[fields[0]];
+      for (uint64_t i = 0; i < fields[2]; i++, at += sizeof(uint64_t)) {
+        if (listed.size() < max_listed) {
+          uint64_t position;
+          memcpy(&position, &all[at], sizeof(position));
+          listed.push_back(position);
+        }
+      }
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,78 @@
+#ifndef __SHARDED_INDEX__
+#define __SHARDED_INDEX__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "mpi.h"
+
+/*
+ * Suffix array split over the processes of a communicator the way a
+ * distributed build leaves it: process r holds the contiguous slice of
+ * suffix array indices [offset_r, offset_r + count_r), in rank order, and
+ * keeps it where it is. Each process also reads the text, for comparing
+ * patterns with its suffixes; with a mapped text only the pages around the
+ * suffixes it actually visits become resident.
+ *
+ * Every process keeps the routing table: the first SHARD_ROUTE_PREFIX
+ * characters of each slice's first suffix. The suffixes starting with a
+ * pattern are one interval of the suffix array, so a slice can only hold
+ * some of them if its first suffix is not above the pattern and the next
+ * slice's first suffix is not below it. Process 0 sends each pattern only
+ * to those slices, which search it in their own part with find_ranges and
+ * send back what they found. Patterns go out in rounds of SHARD_ROUND so
+ * the buffers stay bounded, and each slice searches SHARD_BATCH at a time
+ * in lockstep.
+ */
+const uint32_t SHARD_ROUTE_PREFIX = 64;
+const uint64_t SHARD_ROUND = 1 << 16;
+const uint32_t SHARD_BATCH = 32;
+
+class ShardedIndex {
+ public:
+  ShardedIndex();
+
+  // Collective. slice holds count entries of width 4 or 8 bytes, starting
+  // at suffix array index offset, of the suffix array of text[0, size).
+  // Fails on every process if any slice runs past the suffix array.
+  int32_t open(const unsigned char* text, uint64_t size, const void* slice,
+               uint32_t width, uint64_t offset, uint64_t count,
+               MPI_Comm comm = MPI_COMM_WORLD);
+
+  // Range [first, last] of the processes whose slices may hold suffixes
+  // starting with the pattern; first > last if none can.
+  void route(const unsigned char* pattern, uint32_t length, int& first,
+             int& last) const;
+
+  // Collective. Finds the patterns given on process 0, which receives the
+  // number of occurrences of each and up to max_listed of their positions,
+  // in suffix array order. Returns -1 on every process if any failed.
+  int32_t query(const std::vector<std::string>& patterns, uint64_t max_listed,
+                std::vector<uint64_t>& counts,
+                std::vector<std::vector<uint64_t> >& positions) const;
+
+ private:
+  // Whether the first suffix of slice r is above every suffix starting
+  // with the pattern, or below every one.
+  bool above(int r, const unsigned char* pattern, uint32_t length) const;
+  bool below(int r, const unsigned char* pattern, uint32_t length) const;
+
+  template <typename T>
+  void search(const char* requests, uint64_t bytes, uint64_t max_listed,
+              std::vector<char>& replies) const;
+
+  const unsigned char* text_;
+  uint64_t size_;
+  const void* slice_;
+  uint32_t width_;
+  uint64_t offset_, count_;
+  MPI_Comm comm_;
+  int numprocs_, myid_;
+  // Per process: whether its slice is empty, the routing prefix, and
+  // whether that prefix is the whole suffix.
+  std::vector<bool> empty_;
+  std::vector<std::string> first_suffix_;
+  std::vector<bool> complete_;
+};
+
+#endif
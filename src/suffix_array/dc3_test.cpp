@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "suffix_array.h"
+
+using namespace std;
+
+// Checks SuffixArray::build against a plain sort of the suffixes. Run it
+// under mpirun with any number of processes. Small alphabets repeat the
+// sample triples, so DC3 recurses on their names at most lengths.
+
+static const unsigned char* sort_text;
+static uint64_t sort_size;
+
+static bool suffix_less(uint32_t a, uint32_t b) {
+  return lexicographical_compare(sort_text + a, sort_text + sort_size,
+                                 sort_text + b, sort_text + sort_size);
+}
+
+static vector<uint32_t> naive_suffix_array(const string& text) {
+  sort_text = reinterpret_cast<const unsigned char*>(text.data());
+  sort_size = text.size();
+  vector<uint32_t> sa(text.size());
+  for (uint32_t i = 0; i < sa.size(); i++) {
+    sa[i] = i;
+  }
+  sort(sa.begin(), sa.end(), suffix_less);
+  return sa;
+}
+
+// Builds a text of n characters split as the builder splits a file of n + 1
+// bytes, and checks the gathered arrays on process 0. Returns 1 if some
+// block is too small for DC3 and the size was skipped.
+static int32_t test_build(uint64_t n, int alphabet) {
+  int numprocs, myid;
+  MPI_Comm_size(MPI_COMM_WORLD, &numprocs);
+  MPI_Comm_rank(MPI_COMM_WORLD, &myid);
+  // Same text everywhere.
+  srand(static_cast<unsigned>(n * 31 + alphabet));
+  string text(n, 'a');
+  for (uint64_t i = 0; i < n; i++) {
+    text[i] = 'a' + rand() % alphabet;
+  }
+
+  uint64_t offset, size;
+  block_range(n + 1, numprocs, myid, 1, offset, size);
+  int small = size < 3;
+  MPI_Allreduce(MPI_IN_PLACE, &small, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+  if (small) {
+    return 1;
+  }
+
+  // Reads past the end of the text give 0, so the block needs no padding.
+  const text_view view = {text.data() + offset, 0, 1, n - offset};
+  vector<uint32_t> local_sa(size), local_isa(size);
+  SuffixArray st;
+  int ok = st.build(view, static_cast<uint32_t>(size),
+                    static_cast<uint32_t>(n + 1),
+                    static_cast<uint32_t>(offset), numprocs, myid,
+                    local_sa.data(), local_isa.data()) == 0;
+  MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+  if (ok) {
+    vector<int> counts(numprocs), displs(numprocs);
+    const int count = static_cast<int>(size);
+    MPI_Allgather(&count, 1, MPI_INT, counts.data(), 1, MPI_INT,
+                  MPI_COMM_WORLD);
+    for (int i = 1; i < numprocs; i++) {
+      displs[i] = displs[i - 1] + counts[i - 1];
+    }
+    vector<uint32_t> suffix_array(n), inverse_suffix_array(n);
+    MPI_Gatherv(local_sa.data(), count, MPI_UNSIGNED, suffix_array.data(),
+                counts.data(), displs.data(), MPI_UNSIGNED, 0,
+                MPI_COMM_WORLD);
+    MPI_Gatherv(local_isa.data(), count, MPI_UNSIGNED,
+                inverse_suffix_array.data(), counts.data(), displs.data(),
+                MPI_UNSIGNED, 0, MPI_COMM_WORLD);
+    if (myid == 0) {
+      const vector<uint32_t> sa = naive_suffix_array(text);
+      for (uint64_t i = 0; i < n; i++) {
+        ok = ok && suffix_array[i] == sa[i] &&
+             inverse_suffix_array[sa[i]] == i;
+      }
+    }
+  }
+  MPI_Bcast(&ok, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  if (!ok) {
+    if (myid == 0) {
+      fprintf(stderr, "build p %d n %lu alphabet %d failed\n", numprocs, n,
+              alphabet);
+    }
+    return -1;
+  }
+  return 0;
+}
+
+int main(int argc, char* argv[]) {
+  MPI_Init(&argc, &argv);
+  int myid;
+  MPI_Comm_rank(MPI_COMM_WORLD, &myid);
+  // The builder reports progress on stdout.
+  if (freopen("/dev/null", "w", stdout) == NULL) {
+    return 1;
+  }
+
+  // Every length up to 200 covers each residue mod 3 on every split.
+  const int alphabets[] = {1, 2, 4};
+  const uint64_t sizes[] = {1000, 4096, 70000};
+  int failures = 0;
+  for (uint64_t n = 1; n <= 200; n++) {
+    for (int alphabet : alphabets) {
+      failures += test_build(n, alphabet) < 0;
+    }
+  }
+  for (uint64_t n : sizes) {
+    failures += test_build(n, 2) < 0;
+  }
+
+  if (myid == 0) {
+    fprintf(stderr, "%d failures\n", failures);
+  }
+  MPI_Finalize();
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,108 @@
+#include "distributed_bwt.h"
+
+#include <string.h>
+#include <algorithm>
+
+int32_t distributed_bwt(const text_view& data, uint32_t size, uint32_t offset,
+                        const uint32_t* inverse_suffix_array,
+                        std::vector<char>& out, uint64_t& out_offset,
+                        MPI_Comm comm) {
+  int myid;
+  MPI_Comm_rank(comm, &myid);
+  uint64_t text_size = 0;
+  const uint64_t local_size = size;
+  MPI_Allreduce(&local_size, &text_size, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM,
+                comm);
+
+  const uint64_t header = myid == 0 ? BWT_FILE_HEADER : 0;
+  out.assign(header + size + (myid == 0 ? 1 : 0), 0);
+  uint32_t primary = 0;
+  if (distributed_bwt(data, size, offset, inverse_suffix_array,
+                      &out[header], primary, comm) < 0) {
+    return -1;
+  }
+  if (myid == 0) {
+    const uint64_t fields[2] = {text_size, primary};
+    memcpy(&out[0], fields, sizeof(fields));
+  }
+  out_offset = myid == 0 ? 0 : BWT_FILE_HEADER + static_cast<uint64_t>(offset) + 1;
+  return 0;
+}
+
+int32_t distributed_bwt(const text_view& data, uint32_t size, uint32_t offset,
+                        const uint32_t* inverse_suffix_array, char* rows,
+                        uint32_t& primary, MPI_Comm comm) {
+  int numprocs, myid;
+  MPI_Comm_size(comm, &numprocs);
+  MPI_Comm_rank(comm, &myid);
+
+  std::vector<uint32_t> offsets(numprocs);
+  MPI_Allgather(&offset, 1, MPI_UNSIGNED, &offsets[0], 1, MPI_UNSIGNED, comm);
+
+  // Row of the suffix right after this block; the last block's is the $ row.
+  uint32_t first_rank = size > 0 ? inverse_suffix_array[0] : 0;
+  uint32_t next_rank = 0;
+  MPI_Sendrecv(&first_rank, 1, MPI_UNSIGNED, myid > 0 ? myid - 1 : MPI_PROC_NULL,
+               0, &next_rank, 1, MPI_UNSIGNED,
+               myid + 1 < numprocs ? myid + 1 : MPI_PROC_NULL, 0, comm,
+               MPI_STATUS_IGNORE);
+  primary = first_rank + 1;
+  MPI_Bcast(&primary, 1, MPI_UNSIGNED, 0, comm);
+
+  // Character i of the block belongs to the row of suffix i + 1. Row 0 is
+  // on the first process, row r > 0 wherever suffix array index r - 1 is.
+  std::vector<uint64_t> pairs(size);
+  std::vector<int> send_counts(numprocs, 0);
+  std::vector<int> owner(size);
+  for (uint32_t i = 0; i < size; i++) {
+    uint64_t row;
+    if (i + 1 < size) {
+      row = static_cast<uint64_t>(inverse_suffix_array[i + 1]) + 1;
+    } else {
+      row = myid + 1 < numprocs ? static_cast<uint64_t>(next_rank) + 1 : 0;
+    }
+    const int dest =
+        row == 0 ? 0
+                 : std::upper_bound(offsets.begin(), offsets.end(),
+                                    static_cast<uint32_t>(row - 1)) -
+                       offsets.begin() - 1;
+    pairs[i] = (row << 8) | static_cast<unsigned char>(data[i]);
+    owner[i] = dest;
+    send_counts[dest]++;
+  }
+  std::vector<int> send_displs(numprocs, 0), recv_counts(numprocs),
+      recv_displs(numprocs, 0);
+  for (int r = 1; r < numprocs; r++) {
+    send_displs[r] = send_displs[r - 1] + send_counts[r - 1];
+  }
+  std::vector<uint64_t> send(size);
+  std::vector<int> fill(send_displs);
+  for (uint32_t i = 0; i < size; i++) {
+    send[fill[owner[i]]++] = pairs[i];
+  }
+  std::vector<uint64_t>().swap(pairs);
+  MPI_Alltoall(&send_counts[0], 1, MPI_INT, &recv_counts[0], 1, MPI_INT,
+               comm);
+  for (int r = 1; r < numprocs; r++) {
+    recv_displs[r] = recv_displs[r - 1] + recv_counts[r - 1];
+  }
+  std::vector<uint64_t> recv(recv_displs[numprocs - 1] +
+                             recv_counts[numprocs - 1] + 1);
+  MPI_Alltoallv(&send[0], &send_counts[0], &send_displs[0],
+                MPI_UNSIGNED_LONG_LONG, &recv[0], &recv_counts[0],
+                &recv_displs[0], MPI_UNSIGNED_LONG_LONG, comm);
+
+  // This process's rows start at first_row; the primary row stays 0.
+  const uint64_t first_row = myid == 0 ? 0 : static_cast<uint64_t>(offset) + 1;
+  const uint64_t num_rows = size + (myid == 0 ? 1 : 0);
+  memset(rows, 0, num_rows);
+  const uint64_t received = recv.size() - 1;
+  for (uint64_t k = 0; k < received; k++) {
+    const uint64_t row = recv[k] >> 8;
+    if (row < first_row || row - first_row >= num_rows) {
+      return -1;
+    }
+    rows[row - first_row] = static_cast<char>(recv[k] & 0xff);
+  }
+  return 0;
+}
@@ -0,0 +1,39 @@
+#ifndef __DISTRIBUTED_BWT__
+#define __DISTRIBUTED_BWT__
+
+#include <stdint.h>
+#include <vector>
+#include "mpi.h"
+#include "../io/fileio.h"
+
+/*
+ * BWT of the text indexed by a distributed build, from its inverse suffix
+ * array. Rows 0..n are the sorted suffixes of text$ for the n indexed
+ * characters, row 0 being $ alone, so row i + 1 is suffix array index i.
+ * Each row holds the character before its suffix. The primary row, whose
+ * suffix is the whole text, stands for $ and holds 0.
+ *
+ * Every process knows the row of each suffix starting in its block, so it
+ * sends its characters to the rows after them: one all-to-all of
+ * (row, character) pairs.
+ *
+ * File layout: u64 n, u64 primary row, then the n + 1 row characters.
+ */
+const uint64_t BWT_FILE_HEADER = 16;
+
+// Fills out with this process's bytes of the BWT file, which go at byte
+// out_offset: the header and row 0 on the first process, then the rows of
+// suffix array indices [offset, offset + size).
+int32_t distributed_bwt(const text_view& data, uint32_t size, uint32_t offset,
+                        const uint32_t* inverse_suffix_array,
+                        std::vector<char>& out, uint64_t& out_offset,
+                        MPI_Comm comm = MPI_COMM_WORLD);
+
+// Same, writing only the rows: row 0 and the rows of suffix array indices
+// [offset, offset + size) on the first process, the latter elsewhere. All
+// processes receive the primary row.
+int32_t distributed_bwt(const text_view& data, uint32_t size, uint32_t offset,
+                        const uint32_t* inverse_suffix_array, char* rows,
+                        uint32_t& primary, MPI_Comm comm = MPI_COMM_WORLD);
+
+#endif
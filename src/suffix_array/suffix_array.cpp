@@ -1,6 +1,7 @@
 #include "suffix_array.h"
 #include "../sort/ssort.h"
 #include "../sais/sais.h"
+#include "../isa/isa.h"
 
 typedef struct dc3_elem {
   uint32_t word;
@@ -93,7 +94,16 @@ SuffixArray::SuffixArray() {
 
 int32_t SuffixArray::build(const char* data, uint32_t size, uint32_t file_size,
                            uint32_t offset, int numprocs, int myid,
-                           uint32_t* suffix_array) {
+                           uint32_t* suffix_array,
+                           uint32_t* inverse_suffix_array, MPI_Comm comm) {
+  return build(forward_view(data), size, file_size, offset, numprocs, myid,
+               suffix_array, inverse_suffix_array, comm);
+}
+
+int32_t SuffixArray::build(const text_view& data, uint32_t size,
+                           uint32_t file_size, uint32_t offset, int numprocs,
+                           int myid, uint32_t* suffix_array,
+                           uint32_t* inverse_suffix_array, MPI_Comm comm) {
   // If N is small, switch to single thread.
 
   // If N is med, switch to single core.
@@ -103,7 +113,7 @@ int32_t SuffixArray::build(const char* data, uint32_t size, uint32_t file_size,
    *  S = <(T[i,i+2], i) : i \in [0,n), i mod 3 \not= 0>
    */
   double elapsed = 0;
-  MPI_Barrier(MPI_COMM_WORLD);
+  MPI_Barrier(comm);
   if (!myid) {
     fprintf(stdout, "Building component 1\n");
     elapsed = MPI::Wtime();
@@ -139,20 +149,20 @@ int32_t SuffixArray::build(const char* data, uint32_t size, uint32_t file_size,
    *  Component 2:
    *  Sort S by first component.
    */
-  MPI_Barrier(MPI_COMM_WORLD);
+  MPI_Barrier(comm);
   if (!myid) {
     fprintf(stdout, "Runtime of component 1: %f\n\n", MPI::Wtime() - elapsed);
     elapsed = MPI::Wtime();
     fprintf(stdout, "Building component 2\n");
   }
   ssort::samplesort(S, S + dc3_elem_array_size, compare_dc3_elem, mpi_dc3_elem,
-                    numprocs, myid);
+                    numprocs, myid, comm);
 
   /*
    *  Component 3:
    *  P := name (S)
    */
-  MPI_Barrier(MPI_COMM_WORLD);
+  MPI_Barrier(comm);
   if (!myid) {
     fprintf(stdout, "Runtime of component 2: %f\n\n", MPI::Wtime() - elapsed);
     elapsed = MPI::Wtime();
@@ -164,12 +174,12 @@ int32_t SuffixArray::build(const char* data, uint32_t size, uint32_t file_size,
   // last element of previous process. So we use SEND / RECV.
   if (myid != numprocs - 1) {
     MPI_Send(S + (dc3_elem_array_size - 1), 1, mpi_dc3_elem, myid + 1, 0,
-             MPI_COMM_WORLD);
+             comm);
   }
 
   dc3_elem start;
   if (myid != 0) {
-    MPI_Recv(&start, 1, mpi_dc3_elem, myid - 1, 0, MPI_COMM_WORLD,
+    MPI_Recv(&start, 1, mpi_dc3_elem, myid - 1, 0, comm,
              MPI_STATUS_IGNORE);
   }
 
@@ -193,14 +203,14 @@ int32_t SuffixArray::build(const char* data, uint32_t size, uint32_t file_size,
                           is_diff_from_adj[i - 1];
   }
 
-  MPI_Barrier(MPI_COMM_WORLD);  // test only
+  MPI_Barrier(comm);  // test only
 
   // We want to produce a scan over the is_diff array across all processors.
   // The sum of each individual array is is_diff[_size - 1]. We do an
   // exclusive scan on this to propagate the partial sums.
   uint32_t prefix_sum = 0;
   MPI_Exscan(&is_diff_from_adj[dc3_elem_array_size - 1], &prefix_sum, 1,
-             MPI_UNSIGNED, MPI_SUM, MPI_COMM_WORLD);
+             MPI_UNSIGNED, MPI_SUM, comm);
 
   // Update names with prefix sum.
   uint32_t* names = is_diff_from_adj;
@@ -215,7 +225,7 @@ int32_t SuffixArray::build(const char* data, uint32_t size, uint32_t file_size,
    *  SA^{12} = pDC3(<c : (c,i) in P>)
    *  P := <(j+1, mapBack(SA^{12}[j], n/3)) : j < 2n/3>
    */
-  MPI_Barrier(MPI_COMM_WORLD);
+  MPI_Barrier(comm);
   if (!myid) {
     fprintf(stdout, "Runtime of component 3: %f\n\n", MPI::Wtime() - elapsed);
     elapsed = MPI::Wtime();
@@ -232,7 +242,7 @@ int32_t SuffixArray::build(const char* data, uint32_t size, uint32_t file_size,
     total = names[dc3_elem_array_size - 1];
     is_unique = (total == ((file_size - 1) / 3) * 2 + ((file_size - 1) % 3));
   }
-  MPI_Bcast(&is_unique, 1, MPI_UNSIGNED, numprocs - 1, MPI_COMM_WORLD);
+  MPI_Bcast(&is_unique, 1, MPI_UNSIGNED, numprocs - 1, comm);
 
   // @TODO: We can probably reuse S.
   // Generate P array. This stores [name, index].
@@ -246,9 +256,9 @@ int32_t SuffixArray::build(const char* data, uint32_t size, uint32_t file_size,
   if (!is_unique) {
     // Permute.
     ssort::samplesort(P, P + dc3_elem_array_size, compare_P_elem, mpi_dc3_elem,
-                      numprocs, myid);
+                      numprocs, myid, comm);
 
-    MPI_Barrier(MPI_COMM_WORLD);
+    MPI_Barrier(comm);
     double recursivet = 0;
     if (!myid)
       recursivet = MPI::Wtime();
@@ -273,7 +283,7 @@ int32_t SuffixArray::build(const char* data, uint32_t size, uint32_t file_size,
     int dc3_elem_array_size_int = dc3_elem_array_size;
     // send sizes of local arrays in preparation for sending the local arrays
     MPI_Gather(&dc3_elem_array_size_int, 1, MPI_INT, &sizes[0], 1, MPI_INT,
-               numprocs - 1, MPI_COMM_WORLD);
+               numprocs - 1, comm);
 
     if (myid == numprocs - 1) {
       displ[0] = 0;
@@ -281,23 +291,37 @@ int32_t SuffixArray::build(const char* data, uint32_t size, uint32_t file_size,
         displ[i] = displ[i - 1] + sizes[i - 1];
       total_size = displ[numprocs - 1] + sizes[numprocs - 1];
 
-      all_names = new int[total_size];
+      all_names = new int[total_size + 1];
     }
 
     // send local arrays to root
-    MPI_Barrier(MPI_COMM_WORLD);
+    MPI_Barrier(comm);
     double ag = MPI :: Wtime();
 
     MPI_Gatherv(names, dc3_elem_array_size_int, MPI_UNSIGNED, all_names, sizes,
-                displ, MPI_INT, numprocs - 1, MPI_COMM_WORLD);
-    MPI_Barrier(MPI_COMM_WORLD);
+                displ, MPI_INT, numprocs - 1, comm);
+    MPI_Barrier(comm);
     if (!myid) printf("Gatherv time %f\n", MPI::Wtime() - ag);
 
     if (myid == numprocs - 1) {
-      all_SA = new int[total_size];
+      all_SA = new int[total_size + 1];
+
+      // Names start at 1, so 0 between the 1 mod 3 and 2 mod 3 names is a
+      // unique smallest separator. The padding only ends the 1 mod 3 part
+      // when its last triple runs past the text.
+      const uint32_t ones = file_size / 3;
+      memmove(all_names + ones + 1, all_names + ones,
+              (total_size - ones) * sizeof(int));
+      all_names[ones] = 0;
 
       // recurse
-      sais_int(all_names, all_SA, total_size, total + 1);
+      sais_int(all_names, all_SA, total_size + 1, total + 1);
+
+      // The separator's suffix sorts first; drop it.
+      for (uint32_t i = 1; i <= total_size; i++) {
+        const uint32_t j = all_SA[i];
+        all_SA[i - 1] = j > ones ? j - 1 : j;
+      }
 
       delete[] all_names;
     }
@@ -305,26 +329,26 @@ int32_t SuffixArray::build(const char* data, uint32_t size, uint32_t file_size,
     int* local_SA = new int[dc3_elem_array_size];
 
     // send result of recursive call back to nodes
-    MPI_Barrier(MPI_COMM_WORLD);
+    MPI_Barrier(comm);
     ag = MPI :: Wtime();
 
     MPI_Scatterv(all_SA, sizes, displ, MPI_INT, local_SA,
                  dc3_elem_array_size_int, MPI_INT, numprocs - 1,
-                 MPI_COMM_WORLD);
-    MPI_Barrier(MPI_COMM_WORLD);
+                 comm);
+    MPI_Barrier(comm);
     if (!myid) printf("Scatterv time %f\n", MPI::Wtime() - ag);
 
     int global_idx;
 
     // tell each processor what their index their array starts on globally
     MPI_Scatter(displ, 1, MPI_INT, &global_idx, 1, MPI_INT, numprocs - 1,
-                MPI_COMM_WORLD);
-    MPI_Barrier(MPI_COMM_WORLD);
+                comm);
+    MPI_Barrier(comm);
     if (!myid) printf("Runtime of sais call: %f\n\n", MPI::Wtime() - recursivet);
 
     for (int i = 0; i < dc3_elem_array_size_int; i++) {
       P[i].word = global_idx + i + 1;
-      P[i].index = map_back(local_SA[i], (file_size + 1) / 3);
+      P[i].index = map_back(local_SA[i], file_size / 3);
     }
 
     delete[] sizes;
@@ -337,7 +361,7 @@ int32_t SuffixArray::build(const char* data, uint32_t size, uint32_t file_size,
 
   // Sort P by second element. This aids in next component's construction.
   ssort::samplesort(P, P + dc3_elem_array_size, compare_sortedP_elem,
-                    mpi_dc3_elem, numprocs, myid);
+                    mpi_dc3_elem, numprocs, myid, comm);
 
   /*
    *  @TODO: Component 5:
@@ -347,7 +371,7 @@ int32_t SuffixArray::build(const char* data, uint32_t size, uint32_t file_size,
    *  S_2 := <(c, T[i], T[i+1], c'', i) : i mod 3 = 2), (c,i), (c'', i+2) in
    P>
    */
-  MPI_Barrier(MPI_COMM_WORLD);
+  MPI_Barrier(comm);
   if (!myid) {
     fprintf(stdout, "Runtime of component 4: %f\n\n", MPI::Wtime() - elapsed);
     elapsed = MPI::Wtime();
@@ -356,7 +380,7 @@ int32_t SuffixArray::build(const char* data, uint32_t size, uint32_t file_size,
 
   // We need the first two elements of the next process.
   if (myid != 0) {
-    MPI_Send(&P[0], 2, mpi_dc3_elem, myid - 1, 0, MPI_COMM_WORLD);
+    MPI_Send(&P[0], 2, mpi_dc3_elem, myid - 1, 0, comm);
   }
 
   dc3_elem* next2 = new dc3_elem[2]();
@@ -364,7 +388,7 @@ int32_t SuffixArray::build(const char* data, uint32_t size, uint32_t file_size,
     return -1;
   }
   if (myid != numprocs - 1) {
-    MPI_Recv(next2, 2, mpi_dc3_elem, myid + 1, 0, MPI_COMM_WORLD,
+    MPI_Recv(next2, 2, mpi_dc3_elem, myid + 1, 0, comm,
              MPI_STATUS_IGNORE);
   }
 
@@ -459,7 +483,7 @@ int32_t SuffixArray::build(const char* data, uint32_t size, uint32_t file_size,
    *  Component 6:
    *  Sort S_0 union S_1 union S_2 using compare operator in paper.
    */
-  MPI_Barrier(MPI_COMM_WORLD);
+  MPI_Barrier(comm);
   if (!myid) {
     fprintf(stdout, "Runtime of component 5: %f\n\n", MPI::Wtime() - elapsed);
     elapsed = MPI::Wtime();
@@ -467,13 +491,14 @@ int32_t SuffixArray::build(const char* data, uint32_t size, uint32_t file_size,
   }
 
   ssort::samplesort(SS, SS + size, compare_tuple_elem, mpi_dc3_tuple_elem,
-                    numprocs, myid);
+                    numprocs, myid, comm);
 
   /*
    *  Component 7:
    *  Return last component of (s : s in S).
+   *  Optionally ISA := <(i, r) : (r, i) in SA>, permuted to text blocks.
    */
-  MPI_Barrier(MPI_COMM_WORLD);
+  MPI_Barrier(comm);
   if (!myid) {
     fprintf(stdout, "Runtime of component 6: %f\n\n", MPI::Wtime() - elapsed);
     elapsed = MPI::Wtime();
@@ -484,7 +509,15 @@ int32_t SuffixArray::build(const char* data, uint32_t size, uint32_t file_size,
     suffix_array[i] = SS[i].index;
   }
 
-  MPI_Barrier(MPI_COMM_WORLD);
+  // Samplesort keeps the local sizes, so this SA slice covers global ranks
+  // [offset, offset + size) like the text block.
+  if (inverse_suffix_array != NULL &&
+      isa::invert(suffix_array, size, offset, inverse_suffix_array,
+                  MPI_UNSIGNED, numprocs, comm) < 0) {
+    return -1;
+  }
+
+  MPI_Barrier(comm);
   if (!myid) {
     fprintf(stdout, "Runtime of component 7: %f\n\n", MPI::Wtime() - elapsed);
   }
@@ -4,13 +4,23 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "mpi.h"
+#include "../io/fileio.h"
 
 class SuffixArray {
  public:
   SuffixArray();
+  // If inverse_suffix_array is given, it receives the ranks of the suffixes
+  // starting in this process's text block, in text order. numprocs and myid
+  // are the size of comm and the rank in it.
   int32_t build(const char* data, uint32_t size, uint32_t file_size,
                 uint32_t offset, int numprocs, int myid,
-                uint32_t* suffix_array);
+                uint32_t* suffix_array, uint32_t* inverse_suffix_array = NULL,
+                MPI_Comm comm = MPI_COMM_WORLD);
+  // Same, reading the block through a view, e.g. of the reversed text.
+  int32_t build(const text_view& data, uint32_t size, uint32_t file_size,
+                uint32_t offset, int numprocs, int myid,
+                uint32_t* suffix_array, uint32_t* inverse_suffix_array = NULL,
+                MPI_Comm comm = MPI_COMM_WORLD);
 
  private:
   MPI_Datatype mpi_dc3_elem;